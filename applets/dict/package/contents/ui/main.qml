@@ -20,12 +20,15 @@ import QtQuick 2.0
 import QtQuick.Layouts 1.1
 import org.kde.plasma.components 2.0 as PlasmaComponents
 import org.kde.plasma.core 2.0 as PlasmaCore
+import org.kde.plasma.plasmoid 2.0
 import QtWebEngine 1.1
 
 import org.kde.plasma.private.dict 1.0
 
 ColumnLayout {
 
+    Plasmoid.toolTipSubText: dict.summary
+
     DictObject {
         id: dict
         selectedDictionary: plasmoid.configuration.dictionary
@@ -17,6 +17,7 @@
  */
 
 #include "dict_object.h"
+#include <dictparser.h>
 #include <QDebug>
 #include <KLocalizedString>
 #include <QQuickWebEngineProfile>
@@ -69,6 +70,10 @@ void DictObject::lookup(const QString &word)
     if (!newSource.isEmpty()) {
         // Look up new definition
         emit searchInProgress();
+        if (!m_summary.isEmpty()) {
+            m_summary.clear();
+            emit summaryChanged();
+        }
         m_source = newSource;
         m_dataEngine->connectSource(m_source, this);
     }
@@ -80,6 +85,15 @@ void DictObject::dataUpdated(const QString &sourceName, const Plasma::DataEngine
     const QString html = data.value(QStringLiteral("text")).toString();
     if (!html.isEmpty()) {
         emit definitionFound(html);
+
+        const QVector<DictParser::Definition> definitions = DictParser::definitions(html);
+        if (!definitions.isEmpty()) {
+            const DictParser::Definition &first = definitions.first();
+            m_summary = first.partOfSpeech.isEmpty()
+                ? first.text
+                : i18nc("@info:tooltip part of speech, definition", "%1: %2", first.partOfSpeech, first.text);
+            emit summaryChanged();
+        }
     }
 }
 
@@ -94,6 +108,11 @@ void DictObject::setSelectedDictionary(const QString& dict)
 }
 
 
+QString DictObject::summary() const
+{
+    return m_summary;
+}
+
 QQuickWebEngineProfile* DictObject::webProfile() const
 {
     return m_webProfile;
@@ -28,6 +28,7 @@ class DictObject : public QObject, public Plasma::DataEngineConsumer
     Q_OBJECT
     Q_PROPERTY(QQuickWebEngineProfile* webProfile READ webProfile CONSTANT)
     Q_PROPERTY(QString selectedDictionary READ selectedDictionary WRITE setSelectedDictionary)
+    Q_PROPERTY(QString summary READ summary NOTIFY summaryChanged)
 
 public:
     explicit DictObject(QObject *parent = nullptr);
@@ -37,6 +38,9 @@ public:
     QString selectedDictionary() const;
     void setSelectedDictionary(const QString &dict);
 
+    /// the first definition of the word looked up, in plain text
+    QString summary() const;
+
 public Q_SLOTS:
     void lookup(const QString &word);
 
@@ -46,11 +50,13 @@ private Q_SLOTS:
 Q_SIGNALS:
     void searchInProgress();
     void definitionFound(const QString &html);
+    void summaryChanged();
 
 private:
     QString m_source;
     QString m_dataEngineName;
     QString m_selectedDict;
+    QString m_summary;
 
     Plasma::DataEngine* m_dataEngine;
     QQuickWebEngineProfile* m_webProfile;
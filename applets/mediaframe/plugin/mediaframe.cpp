@@ -23,16 +23,62 @@
 #include <QFileInfo>
 #include <QUrl>
 #include <QDebug>
+#include <QImage>
 #include <QImageReader>
 #include <QMimeDatabase>
 #include <QTime>
 #include <QRegularExpression>
 #include <QCryptographicHash>
 #include <QRandomGenerator>
+#include <QGuiApplication>
+#include <QScreen>
+#include <QRunnable>
+#include <QThreadPool>
 
 #include <KIO/StoredTransferJob>
 #include <KIO/Job>
 
+#include <imageops.h>
+
+/**
+ * Decodes a downloaded image, scales it down if it is larger than
+ * @p maxSize and saves it to the cache, away from the GUI thread.
+ */
+class SaveDownloadThread : public QObject, public QRunnable
+{
+    Q_OBJECT
+
+public:
+    SaveDownloadThread(const QByteArray &data, const QSize &maxSize, const QString &path)
+        : m_data(data),
+          m_maxSize(maxSize),
+          m_path(path)
+    {
+    }
+
+    void run() override
+    {
+        QImage image;
+        image.loadFromData(m_data);
+
+        const QSize size = image.size().scaled(m_maxSize, Qt::KeepAspectRatioByExpanding);
+        if (m_maxSize.isValid() && size.width() < image.width()) {
+            image = ImageOps::downscaled(image, size);
+        }
+
+        image.save(m_path);
+        emit done();
+    }
+
+Q_SIGNALS:
+    void done();
+
+private:
+    QByteArray m_data;
+    QSize m_maxSize;
+    QString m_path;
+};
+
 MediaFrame::MediaFrame(QObject *parent) : QObject(parent)
 {
     const auto imageMimeTypeNames = QImageReader::supportedMimeTypes();
@@ -394,21 +440,28 @@ void MediaFrame::slotFinished(KJob *job)
             m_errorCallback.call(args);
         }
     } else if (KIO::StoredTransferJob *transferJob = qobject_cast<KIO::StoredTransferJob *>(job)) {
-        QImage image;
-
         // TODO make proper caching calls
-        QString path = m_filename;
+        const QString path = m_filename;
         qDebug() << "Saving download to" << path;
 
-        image.loadFromData(transferJob->data());
-        image.save(path);
+        // the frame is never larger than the largest screen, so neither is the cached copy
+        QSize screenSize;
+        const auto screens = QGuiApplication::screens();
+        for (const QScreen *screen : screens) {
+            screenSize = screenSize.expandedTo(screen->size() * screen->devicePixelRatio());
+        }
 
-        qDebug() << "Saved to" << path;
+        // another download may have been started by the time this one is saved
+        const QJSValue successCallback = m_successCallback;
+        SaveDownloadThread *thread = new SaveDownloadThread(transferJob->data(), screenSize, path);
+        connect(thread, &SaveDownloadThread::done, this, [successCallback, path]() mutable {
+            qDebug() << "Saved to" << path;
 
-        if(m_successCallback.isCallable()) {
-            args << QJSValue(path);
-            m_successCallback.call(args);
-        }
+            if (successCallback.isCallable()) {
+                successCallback.call(QJSValueList{ QJSValue(path) });
+            }
+        });
+        QThreadPool::globalInstance()->start(thread);
     }
     else {
         errorMessage = QStringLiteral("Unknown error occurred");
@@ -421,3 +474,5 @@ void MediaFrame::slotFinished(KJob *job)
         }
     }
 }
+
+#include "mediaframe.moc"
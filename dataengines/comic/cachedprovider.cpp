@@ -20,6 +20,7 @@
 
 #include <QDir>
 #include <QFile>
+#include <QSaveFile>
 #include <QSettings>
 #include <QTimer>
 #include <QImage>
@@ -192,7 +193,12 @@ bool CachedProvider::storeInCache(const QString &identifier, const QImage &comic
         settingsMain.setValue(QLatin1String("comics"), comics);
     }
 
-    return comic.save(path, "PNG");
+    // never leave a half written file behind when interrupted
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly) || !comic.save(&file, "PNG")) {
+        return false;
+    }
+    return file.commit();
 }
 
 QUrl CachedProvider::websiteUrl() const
@@ -25,13 +25,43 @@
 #include <QUrl>
 #include <QDebug>
 #include <QStandardPaths>
+#include <QRunnable>
+#include <QThreadPool>
 
 #include <Plasma/DataContainer>
 #include <KPackage/PackageLoader>
 
+#include <imageops.h>
+
 #include "cachedprovider.h"
 #include "comicproviderkross.h"
 
+/**
+ * Converts a strip to the format it is painted in, away from the GUI thread,
+ * as strips can be very large.
+ */
+class DisplayFormatThread : public QObject, public QRunnable
+{
+    Q_OBJECT
+
+public:
+    explicit DisplayFormatThread(const QImage &image)
+        : m_image(image)
+    {
+    }
+
+    void run() override
+    {
+        emit done(ImageOps::toDisplayFormat(m_image));
+    }
+
+Q_SIGNALS:
+    void done(const QImage &image);
+
+private:
+    QImage m_image;
+};
+
 ComicEngine::ComicEngine(QObject* parent, const QVariantList& args)
     : Plasma::DataEngine(parent, args), mEmptySuffix(false)
 {
@@ -183,13 +213,25 @@ bool ComicEngine::sourceRequestEvent(const QString &identifier)
 
 void ComicEngine::finished(ComicProvider *provider)
 {
-    // sets the data
-    setComicData(provider);
     if (provider->image().isNull()) {
         error(provider);
         return;
     }
 
+    // converted once here, instead of on every paint of the applet;
+    // the provider is kept until the data is set
+    DisplayFormatThread *thread = new DisplayFormatThread(provider->image());
+    connect(thread, &DisplayFormatThread::done, provider, [this, provider](const QImage &image) {
+        converted(provider, image);
+    });
+    QThreadPool::globalInstance()->start(thread);
+}
+
+void ComicEngine::converted(ComicProvider *provider, const QImage &image)
+{
+    // sets the data
+    setComicData(provider, image);
+
     // different comic -- with no error yet -- has been chosen, old error is invalidated
     QString temp = mIdentifierError.left(mIdentifierError.indexOf(QLatin1Char(':')) + 1);
     if (!mIdentifierError.isEmpty() && provider->identifier().indexOf(temp) == -1) {
@@ -246,8 +288,8 @@ void ComicEngine::finished(ComicProvider *provider)
 
 void ComicEngine::error(ComicProvider *provider)
 {
-    // sets the data
-    setComicData(provider);
+    // sets the data; there is rarely an image to convert here
+    setComicData(provider, provider->image());
 
     QString identifier(provider->identifier());
     mIdentifierError = identifier;
@@ -281,7 +323,7 @@ void ComicEngine::error(ComicProvider *provider)
     provider->deleteLater();
 }
 
-void ComicEngine::setComicData(ComicProvider *provider)
+void ComicEngine::setComicData(ComicProvider *provider, const QImage &image)
 {
     QString identifier(provider->identifier());
 
@@ -293,7 +335,7 @@ void ComicEngine::setComicData(ComicProvider *provider)
     if (provider->isCurrent())
         identifier = identifier.left(identifier.indexOf(QLatin1Char(':')) + 1);
 
-    setData(identifier, QLatin1String("Image"), provider->image());
+    setData(identifier, QLatin1String("Image"), image);
     setData(identifier, QLatin1String("Website Url"), provider->websiteUrl());
     setData(identifier, QLatin1String("Image Url"), provider->imageUrl());
     setData(identifier, QLatin1String("Shop Url"), provider->shopUrl());
@@ -24,6 +24,7 @@
 #include <QNetworkConfigurationManager>
 
 class ComicProvider;
+class QImage;
 
 /**
  * This class provides the comic strip.
@@ -63,7 +64,8 @@ class ComicEngine : public Plasma::DataEngine
 
     private:
         bool mEmptySuffix;
-        void setComicData(ComicProvider *provider);
+        void converted(ComicProvider *provider, const QImage &image);
+        void setComicData(ComicProvider *provider, const QImage &image);
         QString lastCachedIdentifier(const QString &identifier) const;
         QString mIdentifierError;
         QStringList mProviders;
@@ -19,63 +19,32 @@
  */
 
 #include "apodprovider.h"
+#include "potdparser.h"
+#include "providerurls.h"
 
-#include <QRegExp>
+#include <QDate>
 #include <QDebug>
+#include <QUrl>
 
 #include <KPluginFactory>
-#include <KIO/Job>
 
 ApodProvider::ApodProvider(QObject *parent, const QVariantList &args)
     : PotdProvider(parent, args)
 {
-    const  QUrl url(QStringLiteral("http://antwrp.gsfc.nasa.gov/apod/"));
+    // dated pages are needed to fetch the picture of tomorrow ahead of time
+    const QUrl url = ProviderUrls::apod(isFixedDate() ? date() : QDate());
 
-    KIO::StoredTransferJob *job = KIO::storedGet(url, KIO::NoReload, KIO::HideProgressInfo);
-    connect(job, &KIO::StoredTransferJob::finished, this, &ApodProvider::pageRequestFinished);
-}
-
-ApodProvider::~ApodProvider() = default;
+    fetchPage(url, [](const QByteArray &page) {
+        const QByteArray path = PotdParser::textBetween( page, "<a href=\"image/", "\"" );
+        if ( path.isEmpty() ) {
+            return QUrl();
+        }
 
-QImage ApodProvider::image() const
-{
-    return mImage;
+        return QUrl(QLatin1String("http://antwrp.gsfc.nasa.gov/apod/image/") + QString::fromUtf8( path ));
+    });
 }
 
-void ApodProvider::pageRequestFinished(KJob *_job)
-{
-    KIO::StoredTransferJob *job = static_cast<KIO::StoredTransferJob *>( _job );
-    if ( job->error() ) {
-        emit error(this);
-        return;
-    }
-
-    const QString data = QString::fromUtf8( job->data() );
-
-    const QString pattern = QStringLiteral("<a href=\"(image/.*)\"" );
-    QRegExp exp( pattern );
-    exp.setMinimal( true );
-    if ( exp.indexIn( data ) != -1 ) {
-        const QString sub = exp.cap(1);
-        const QUrl url(QLatin1String("http://antwrp.gsfc.nasa.gov/apod/") + sub);
-        KIO::StoredTransferJob *imageJob = KIO::storedGet( url, KIO::NoReload, KIO::HideProgressInfo );
-        connect(imageJob, &KIO::StoredTransferJob::finished, this, &ApodProvider::imageRequestFinished);
-    } else {
-        emit error(this);
-    }
-}
-
-void ApodProvider::imageRequestFinished(KJob *_job)
-{
-    KIO::StoredTransferJob *job = static_cast<KIO::StoredTransferJob *>( _job );
-    if ( job->error() ) {
-	emit error(this);
-	return;
-    }
-
-    mImage = QImage::fromData( job->data() );
-    emit finished(this);
-}
+ApodProvider::~ApodProvider() = default;
 
 K_PLUGIN_CLASS_WITH_JSON(ApodProvider, "apodprovider.json")
 
@@ -25,8 +25,6 @@
 
 #include <QImage>
 
-class KJob;
-
 /**
  * This class provides the image for APOD 
  * "Astronomy Picture Of the Day"
@@ -53,21 +51,6 @@ class ApodProvider : public PotdProvider
          * Destroys the APOD provider.
          */
         ~ApodProvider() override;
-
-        /**
-         * Returns the requested image.
-         *
-         * Note: This method returns only a valid image after the
-         *       finished() signal has been emitted.
-         */
-        QImage image() const override;
-
-    private:
-        void pageRequestFinished(KJob *job);
-        void imageRequestFinished(KJob *job);
-
-    private:
-        QImage mImage;
 };
 
 #endif
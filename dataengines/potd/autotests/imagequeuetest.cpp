@@ -0,0 +1,178 @@
+/*
+ *   Copyright (C) 2020 by the Plasma Addons authors
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details
+ *
+ *   You should have received a copy of the GNU Library General Public
+ *   License along with this program; if not, write to the
+ *   Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "cachedprovider.h"
+
+#include <QAtomicInt>
+#include <QSemaphore>
+#include <QSignalSpy>
+#include <QTest>
+#include <QThread>
+
+#include <memory>
+#include <vector>
+
+namespace {
+const int producerCount = 8;
+const int pushesPerProducer = 2000;
+}
+
+/**
+ * Pushes into an ImageQueue from many threads at once, the way the
+ * worker threads of the engine do, while the test takes images out.
+ */
+class ImageQueueTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void takeAllInPushOrder();
+    void readyOncePerBatch();
+    void manyProducers();
+    void manyProducersQueued();
+};
+
+void ImageQueueTest::takeAllInPushOrder()
+{
+    ImageQueue queue;
+    QVERIFY(queue.takeAll().isEmpty());
+
+    const QImage image(4, 3, QImage::Format_RGB32);
+    queue.push(ImageQueue::Preview, QStringLiteral("apod"), QString(), QImage());
+    queue.push(ImageQueue::Fetched, QStringLiteral("apod"), QStringLiteral("/cache/apod"), image);
+    queue.push(ImageQueue::Backdrop, QStringLiteral("apod"), QStringLiteral("/cache/apod.backdrop"), image);
+
+    const QVector<ImageQueue::Entry> entries = queue.takeAll();
+    QCOMPARE(entries.count(), 3);
+    QCOMPARE(entries.at(0).kind, ImageQueue::Preview);
+    QVERIFY(entries.at(0).image.isNull());
+    QCOMPARE(entries.at(1).kind, ImageQueue::Fetched);
+    QCOMPARE(entries.at(1).path, QStringLiteral("/cache/apod"));
+    QCOMPARE(entries.at(1).image.size(), QSize(4, 3));
+    QCOMPARE(entries.at(2).kind, ImageQueue::Backdrop);
+    QCOMPARE(entries.at(2).source, QStringLiteral("apod"));
+
+    QVERIFY(queue.takeAll().isEmpty());
+}
+
+void ImageQueueTest::readyOncePerBatch()
+{
+    ImageQueue queue;
+    QSignalSpy ready(&queue, &ImageQueue::ready);
+
+    for (int i = 0; i < 10; ++i) {
+        queue.push(ImageQueue::Cached, QString::number(i), QString(), QImage());
+    }
+    QCOMPARE(ready.count(), 1);
+    QCOMPARE(queue.takeAll().count(), 10);
+
+    // an empty queue notifies again
+    queue.push(ImageQueue::Cached, QStringLiteral("10"), QString(), QImage());
+    QCOMPARE(ready.count(), 2);
+    QCOMPARE(queue.takeAll().count(), 1);
+}
+
+void ImageQueueTest::manyProducers()
+{
+    ImageQueue queue;
+    // QSignalSpy is not meant to be called from several threads
+    QAtomicInt ready;
+    connect(&queue, &ImageQueue::ready, this, [&ready]() { ready.ref(); }, Qt::DirectConnection);
+
+    // the producers start together, so they really push at the same time
+    QSemaphore start;
+    std::vector<std::unique_ptr<QThread>> producers;
+    for (int i = 0; i < producerCount; ++i) {
+        producers.emplace_back(QThread::create([&queue, &start, i]() {
+            start.acquire();
+            for (int j = 0; j < pushesPerProducer; ++j) {
+                queue.push(ImageQueue::Cached, QString::number(i), QString::number(j), QImage());
+            }
+        }));
+        producers.back()->start();
+    }
+    start.release(producerCount);
+
+    // takes while the producers push, like the engine does
+    QVector<ImageQueue::Entry> entries;
+    int batches = 0;
+    auto take = [&]() {
+        const QVector<ImageQueue::Entry> batch = queue.takeAll();
+        if (!batch.isEmpty()) {
+            entries += batch;
+            ++batches;
+        }
+    };
+    while (entries.count() < producerCount * pushesPerProducer / 2) {
+        take();
+    }
+    for (const std::unique_ptr<QThread> &producer : producers) {
+        QVERIFY(producer->wait(30 * 1000));
+    }
+    take();
+
+    QCOMPARE(entries.count(), producerCount * pushesPerProducer);
+
+    // every image once, and those of every producer in the order it pushed them
+    QVector<int> next(producerCount, 0);
+    for (const ImageQueue::Entry &entry : qAsConst(entries)) {
+        const int producer = entry.source.toInt();
+        QCOMPARE(entry.path.toInt(), next[producer]);
+        ++next[producer];
+    }
+    for (int i = 0; i < producerCount; ++i) {
+        QCOMPARE(next.at(i), pushesPerProducer);
+    }
+
+    // every batch starts with the push which found the queue empty
+    QCOMPARE(ready.loadAcquire(), batches);
+}
+
+void ImageQueueTest::manyProducersQueued()
+{
+    // the way PotdEngine takes the images: once per notification, in its own thread
+    QSharedPointer<ImageQueue> queue(new ImageQueue, &QObject::deleteLater);
+    // notifications which are still queued are dropped together with it
+    QObject receiver;
+    int taken = 0;
+    connect(queue.data(), &ImageQueue::ready, &receiver, [&queue, &taken]() {
+        taken += queue->takeAll().count();
+    }, Qt::QueuedConnection);
+
+    std::vector<std::unique_ptr<QThread>> producers;
+    for (int i = 0; i < producerCount; ++i) {
+        producers.emplace_back(QThread::create([queue, i]() {
+            for (int j = 0; j < pushesPerProducer; ++j) {
+                queue->push(ImageQueue::Fetched, QString::number(i), QString::number(j), QImage());
+            }
+        }));
+        producers.back()->start();
+    }
+    for (const std::unique_ptr<QThread> &producer : producers) {
+        QVERIFY(producer->wait(30 * 1000));
+    }
+
+    // no image is left behind without a notification to take it
+    QTRY_COMPARE(taken, producerCount * pushesPerProducer);
+    QVERIFY(queue->takeAll().isEmpty());
+}
+
+QTEST_GUILESS_MAIN(ImageQueueTest)
+
+#include "imagequeuetest.moc"
@@ -0,0 +1,191 @@
+/*
+ *   Copyright (C) 2020 by the Plasma Addons authors
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details
+ *
+ *   You should have received a copy of the GNU Library General Public
+ *   License along with this program; if not, write to the
+ *   Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "pluginindex.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSet>
+#include <QTemporaryDir>
+#include <QTest>
+
+namespace {
+const QString identifierKey = QStringLiteral("X-KDE-PlasmaPoTDProvider-Identifier");
+
+QSet<QString> identifiers(const QVector<KPluginMetaData> &plugins)
+{
+    QSet<QString> result;
+    for (const KPluginMetaData &plugin : plugins) {
+        result.insert(plugin.value(identifierKey));
+    }
+    return result;
+}
+}
+
+/**
+ * Runs PluginIndex on copies of the providers built along with it, in a
+ * library path of their own, and measures how long the engine takes to
+ * find its providers on start-up with and without the index.
+ */
+class PluginIndexTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void init();
+
+    void rebuiltWhenAPluginChanges();
+    void rebuiltWhenPluginsAreAddedOrRemoved();
+    void benchmarkStartup_data();
+    void benchmarkStartup();
+
+private:
+    QString addPlugin(const QString &plugin);
+    // makes the index say something the plugins do not, to tell whether it was used
+    void falsifyIndex();
+    QString indexPath() const;
+
+    QTemporaryDir m_dir;
+};
+
+void PluginIndexTest::initTestCase()
+{
+    QVERIFY(m_dir.isValid());
+    QVERIFY(QDir(m_dir.path()).mkpath(QStringLiteral("plugins/potd")));
+    QCoreApplication::setLibraryPaths({ m_dir.filePath(QStringLiteral("plugins")) });
+}
+
+void PluginIndexTest::init()
+{
+    QDir(m_dir.filePath(QStringLiteral("plugins/potd"))).removeRecursively();
+    QVERIFY(QDir(m_dir.path()).mkpath(QStringLiteral("plugins/potd")));
+    QFile::remove(indexPath());
+}
+
+QString PluginIndexTest::indexPath() const
+{
+    return m_dir.filePath(QStringLiteral("index.json"));
+}
+
+QString PluginIndexTest::addPlugin(const QString &plugin)
+{
+    const QString path = m_dir.filePath(QStringLiteral("plugins/potd/") + QFileInfo(plugin).fileName());
+    return QFile::copy(plugin, path) ? path : QString();
+}
+
+void PluginIndexTest::falsifyIndex()
+{
+    QFile file(indexPath());
+    QVERIFY(file.open(QIODevice::ReadWrite));
+    QJsonObject index = QJsonDocument::fromJson(file.readAll()).object();
+
+    QJsonArray plugins = index.value(QLatin1String("plugins")).toArray();
+    QVERIFY(!plugins.isEmpty());
+    for (int i = 0; i < plugins.count(); ++i) {
+        QJsonObject plugin = plugins.at(i).toObject();
+        QJsonObject metadata = plugin.value(QLatin1String("metadata")).toObject();
+        metadata.insert(identifierKey, QStringLiteral("indexed"));
+        plugin.insert(QStringLiteral("metadata"), metadata);
+        plugins.replace(i, plugin);
+    }
+    index.insert(QStringLiteral("plugins"), plugins);
+
+    QVERIFY(file.resize(0));
+    QVERIFY(file.write(QJsonDocument(index).toJson()) > 0);
+}
+
+void PluginIndexTest::rebuiltWhenAPluginChanges()
+{
+    const QString path = addPlugin(QStringLiteral(APOD_PLUGIN));
+    QVERIFY(!path.isEmpty());
+
+    // the first start scans the plugins and writes the index
+    QCOMPARE(identifiers(PluginIndex::providers(indexPath())), QSet<QString>{ QStringLiteral("apod") });
+    QVERIFY(QFile::exists(indexPath()));
+
+    falsifyIndex();
+    QCOMPARE(identifiers(PluginIndex::providers(indexPath())), QSet<QString>{ QStringLiteral("indexed") });
+
+    // an update of the plugin, which keeps its name
+    QFile plugin(path);
+    QVERIFY(plugin.open(QIODevice::ReadWrite));
+    QVERIFY(plugin.setFileTime(QFileInfo(path).lastModified().addSecs(60), QFileDevice::FileModificationTime));
+    plugin.close();
+
+    QCOMPARE(identifiers(PluginIndex::providers(indexPath())), QSet<QString>{ QStringLiteral("apod") });
+    // and the index is up to date again
+    QCOMPARE(identifiers(PluginIndex::providers(indexPath())), QSet<QString>{ QStringLiteral("apod") });
+}
+
+void PluginIndexTest::rebuiltWhenPluginsAreAddedOrRemoved()
+{
+    QVERIFY(!addPlugin(QStringLiteral(APOD_PLUGIN)).isEmpty());
+    QCOMPARE(PluginIndex::providers(indexPath()).count(), 1);
+
+    falsifyIndex();
+    const QString bing = addPlugin(QStringLiteral(BING_PLUGIN));
+    QVERIFY(!bing.isEmpty());
+    QCOMPARE(identifiers(PluginIndex::providers(indexPath())), (QSet<QString>{ QStringLiteral("apod"), QStringLiteral("bing") }));
+
+    falsifyIndex();
+    QVERIFY(QFile::remove(bing));
+    QCOMPARE(identifiers(PluginIndex::providers(indexPath())), QSet<QString>{ QStringLiteral("apod") });
+}
+
+void PluginIndexTest::benchmarkStartup_data()
+{
+    QTest::addColumn<bool>("indexed");
+
+    QTest::newRow("scanning the plugins") << false;
+    QTest::newRow("reading the index") << true;
+}
+
+void PluginIndexTest::benchmarkStartup()
+{
+    QFETCH(bool, indexed);
+
+    const QStringList plugins = {
+        QStringLiteral(APOD_PLUGIN), QStringLiteral(BING_PLUGIN), QStringLiteral(EPOD_PLUGIN), QStringLiteral(FLICKR_PLUGIN),
+        QStringLiteral(NATGEO_PLUGIN), QStringLiteral(NOAA_PLUGIN), QStringLiteral(UNSPLASH_PLUGIN), QStringLiteral(WCPOTD_PLUGIN),
+    };
+    for (const QString &plugin : plugins) {
+        QVERIFY(!addPlugin(plugin).isEmpty());
+    }
+    PluginIndex::providers(indexPath());
+
+    QVector<KPluginMetaData> providers;
+    QBENCHMARK {
+        if (!indexed) {
+            QFile::remove(indexPath());
+        }
+        providers = PluginIndex::providers(indexPath());
+    }
+    QCOMPARE(providers.count(), plugins.count());
+}
+
+QTEST_GUILESS_MAIN(PluginIndexTest)
+
+#include "pluginindextest.moc"
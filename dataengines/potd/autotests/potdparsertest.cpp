@@ -0,0 +1,230 @@
+/*
+ *   Copyright (C) 2020 by the Plasma Addons authors
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details
+ *
+ *   You should have received a copy of the GNU Library General Public
+ *   License along with this program; if not, write to the
+ *   Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "potdparser.h"
+
+#include <QFile>
+#include <QTest>
+
+namespace {
+QByteArray testData(const QString &fileName)
+{
+    QFile file(QFINDTESTDATA(QLatin1String("data/") + fileName));
+    return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+}
+}
+
+/**
+ * Runs the scanners of PotdParser over the pages the providers fetch,
+ * as recorded in autotests/data, and over the corner cases of the formats.
+ */
+class PotdParserTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void jsonValue_data();
+    void jsonValue();
+    void jsonValues();
+    void xmlElements();
+    void xmlElementsStop();
+    void htmlMeta_data();
+    void htmlMeta();
+    void textBetween_data();
+    void textBetween();
+    void benchmarkJsonValue();
+};
+
+void PotdParserTest::jsonValue_data()
+{
+    QTest::addColumn<QByteArray>("data");
+    QTest::addColumn<QByteArray>("path");
+    QTest::addColumn<QByteArray>("value");
+
+    const QByteArray bing = testData(QStringLiteral("bing.json"));
+    const QByteArray wikimedia = testData(QStringLiteral("wikimedia.json"));
+
+    QTest::newRow("bing url") << bing << QByteArray("images/0/url")
+        << QByteArray("/th?id=OHR.WinterSolstice_EN-US1234567890_1920x1080.jpg&rf=LaDigue_1920x1080.jpg&pid=hp");
+    QTest::newRow("bing urlbase") << bing << QByteArray("images/0/urlbase") << QByteArray("/th?id=OHR.WinterSolstice_EN-US1234567890");
+    QTest::newRow("bing not ascii") << bing << QByteArray("images/0/copyright") << QByteArray("Frozen lake at sunrise (\xc2\xa9 Photographer/Agency)");
+    QTest::newRow("bing after the array") << bing << QByteArray("tooltips/loading") << QByteArray("Loading...");
+    QTest::newRow("bing literal") << bing << QByteArray("images/0/wp") << QByteArray("true");
+    QTest::newRow("bing number") << bing << QByteArray("images/0/drk") << QByteArray("1");
+    QTest::newRow("bing no second image") << bing << QByteArray("images/1/url") << QByteArray();
+    QTest::newRow("bing no such key") << bing << QByteArray("images/0/uhd") << QByteArray();
+    QTest::newRow("wikimedia first") << wikimedia << QByteArray("parse/images/0") << QByteArray("Sunrise_over_the_Alps_from_Zugspitze.jpg");
+    QTest::newRow("wikimedia second") << wikimedia << QByteArray("parse/images/1") << QByteArray("Potd-info.svg");
+
+    QTest::newRow("escapes") << QByteArray(R"({"a": "\"\\\/\n\u00e9"})") << QByteArray("a") << QByteArray("\"\\/\n\xc3\xa9");
+    QTest::newRow("surrogate pair") << QByteArray(R"({"a":"\ud83d\ude00"})") << QByteArray("a") << QByteArray("\xf0\x9f\x98\x80");
+    QTest::newRow("brackets in skipped strings") << QByteArray(R"({"s": ["}]\"", {"x": "{"}], "a": 1})") << QByteArray("a") << QByteArray("1");
+    QTest::newRow("white space") << QByteArray("{\n\t\"a\" :\r\n [ 1 ,\n 2 ] }") << QByteArray("a/1") << QByteArray("2");
+    QTest::newRow("truncated") << QByteArray(R"({"a": "no end)") << QByteArray("a") << QByteArray();
+}
+
+void PotdParserTest::jsonValue()
+{
+    QFETCH(QByteArray, data);
+    QFETCH(QByteArray, path);
+    QFETCH(QByteArray, value);
+
+    const QByteArray result = PotdParser::jsonValue(data, path);
+    QCOMPARE(result, value);
+    QCOMPARE(result.isNull(), value.isNull());
+}
+
+void PotdParserTest::jsonValues()
+{
+    QCOMPARE(PotdParser::jsonValues(testData(QStringLiteral("wikimedia.json")), "parse/images/*"),
+             QList<QByteArray>({ "Sunrise_over_the_Alps_from_Zugspitze.jpg", "Potd-info.svg" }));
+    QCOMPARE(PotdParser::jsonValues(R"({"images": [{"url": "a"}, {"title": "b"}, {"url": "c"}]})", "images/*/url"),
+             QList<QByteArray>({ "a", "c" }));
+
+    // an empty string is a value, unlike a missing one
+    const QByteArray empty = PotdParser::jsonValue(R"({"a": ""})", "a");
+    QVERIFY(empty.isEmpty());
+    QVERIFY(!empty.isNull());
+}
+
+void PotdParserTest::xmlElements()
+{
+    const QByteArray data = testData(QStringLiteral("flickr.xml"));
+
+    QByteArray stat;
+    PotdParser::forEachXmlElement(data, "rsp", [&stat](const PotdParser::XmlAttributes &attributes) {
+        stat = attributes.value("stat");
+        return false;
+    });
+    QCOMPARE(stat, QByteArray("ok"));
+
+    // not the one in the comment, and not <photos>
+    QList<PotdParser::XmlAttributes> photos;
+    PotdParser::forEachXmlElement(data, "photo", [&photos](const PotdParser::XmlAttributes &attributes) {
+        photos << attributes;
+        return true;
+    });
+    QCOMPARE(photos.count(), 3);
+    QCOMPARE(photos.at(0).value("id"), QByteArray("49312417826"));
+    QCOMPARE(photos.at(0).value("title"), QByteArray("Morning fog & frost"));
+    QCOMPARE(photos.at(0).value("url_k"), QByteArray("https://live.staticflickr.com/65535/49312417826_0123456789_k.jpg"));
+    QCOMPARE(photos.at(0).value("url_m"), QByteArray("https://live.staticflickr.com/65535/49312417826_0123456789.jpg"));
+    QCOMPARE(photos.at(1).value("ispublic"), QByteArray("0"));
+    QVERIFY(!photos.at(2).contains("url_k"));
+    QCOMPARE(photos.at(2).value("url_h"), QByteArray("https://live.staticflickr.com/65535/49310987654_2345678901_h.jpg"));
+
+    QList<QByteArray> values;
+    PotdParser::forEachXmlElement("<a x='1'/><![CDATA[<a x='2'/>]]><a\n\tx = \"&lt;3&gt;\" y='&amp;lt;'>", "a",
+                                  [&values](const PotdParser::XmlAttributes &attributes) {
+        values << attributes.value("x") << attributes.value("y");
+        return true;
+    });
+    QCOMPARE(values, QList<QByteArray>({ "1", QByteArray(), "<3>", "&lt;" }));
+}
+
+void PotdParserTest::xmlElementsStop()
+{
+    int calls = 0;
+    PotdParser::forEachXmlElement(testData(QStringLiteral("flickr.xml")), "photo", [&calls](const PotdParser::XmlAttributes &) {
+        ++calls;
+        return false;
+    });
+    QCOMPARE(calls, 1);
+}
+
+void PotdParserTest::htmlMeta_data()
+{
+    QTest::addColumn<QString>("page");
+
+    QTest::newRow("as served") << QStringLiteral("natgeo.html");
+    QTest::newRow("more white space") << QStringLiteral("natgeo-whitespace.html");
+}
+
+// the way NatGeoProvider finds its picture
+void PotdParserTest::htmlMeta()
+{
+    QFETCH(QString, page);
+
+    const QByteArray data = testData(page);
+    QVERIFY(!data.isEmpty());
+
+    QByteArray url;
+    PotdParser::forEachXmlElement(data, "meta", [&url](const PotdParser::XmlAttributes &attributes) {
+        if (attributes.value("property") != "og:image") {
+            return true;
+        }
+        url = attributes.value("content");
+        return false;
+    });
+    QCOMPARE(url, QByteArray("https://www.nationalgeographic.com/content/dam/photography/photo-of-the-day/2020/01/northern-lights.adapt.1900.1.jpg"));
+}
+
+void PotdParserTest::textBetween_data()
+{
+    QTest::addColumn<QByteArray>("data");
+    QTest::addColumn<QByteArray>("before");
+    QTest::addColumn<QByteArray>("after");
+    QTest::addColumn<QByteArray>("text");
+
+    // what ApodProvider, EpodProvider and NOAAProvider look for
+    QTest::newRow("apod") << testData(QStringLiteral("apod.html")) << QByteArray("<a href=\"image/") << QByteArray("\"")
+        << QByteArray("2001/BetelgeuseImagined_EsoCalcada_2400.jpg");
+    QTest::newRow("epod") << testData(QStringLiteral("epod.html")) << QByteArray("://epod.usra.edu/.a/") << QByteArray("-pi")
+        << QByteArray("6a0105371bb32c970b0240a4f0c8b4200c");
+    QTest::newRow("noaa") << testData(QStringLiteral("noaa.html")) << QByteArray("\"/sites/default/files/") << QByteArray(".jpg\"")
+        << QByteArray("GOES16_Hurricane_2019");
+    QTest::newRow("no start") << testData(QStringLiteral("noaa.html")) << QByteArray("<video") << QByteArray(">") << QByteArray();
+    QTest::newRow("no end") << QByteArray("<a href=\"image/x.jpg") << QByteArray("<a href=\"image/") << QByteArray("\"") << QByteArray();
+    QTest::newRow("empty") << QByteArray("<a href=\"image/\">") << QByteArray("<a href=\"image/") << QByteArray("\"") << QByteArray("");
+}
+
+void PotdParserTest::textBetween()
+{
+    QFETCH(QByteArray, data);
+    QFETCH(QByteArray, before);
+    QFETCH(QByteArray, after);
+    QFETCH(QByteArray, text);
+
+    QVERIFY(!data.isEmpty());
+    const QByteArray result = PotdParser::textBetween(data, before, after);
+    QCOMPARE(result, text);
+    QCOMPARE(result.isNull(), text.isNull());
+}
+
+void PotdParserTest::benchmarkJsonValue()
+{
+    // the archive of eight pictures the batch requests of BingProvider fetch
+    const QByteArray image = PotdParser::textBetween(testData(QStringLiteral("bing.json")), "\"images\":[", "],\"tooltips\"");
+    QVERIFY(!image.isEmpty());
+    QByteArray archive = "{\"images\":[" + image;
+    for (int i = 1; i < 8; ++i) {
+        archive += ',' + image;
+    }
+    archive += "],\"tooltips\":{}}";
+
+    QList<QByteArray> urls;
+    QBENCHMARK {
+        urls = PotdParser::jsonValues(archive, "images/*/url");
+    }
+    QCOMPARE(urls.count(), 8);
+}
+
+QTEST_GUILESS_MAIN(PotdParserTest)
+
+#include "potdparsertest.moc"
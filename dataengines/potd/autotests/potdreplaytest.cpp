@@ -0,0 +1,318 @@
+/*
+ *   Copyright (C) 2020 by the Plasma Addons authors
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details
+ *
+ *   You should have received a copy of the GNU Library General Public
+ *   License along with this program; if not, write to the
+ *   Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "potdprovider.h"
+#include "providerurls.h"
+
+#include <QBuffer>
+#include <QCryptographicHash>
+#include <QDate>
+#include <QDir>
+#include <QFile>
+#include <QImage>
+#include <QRandomGenerator>
+#include <QSignalSpy>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QTest>
+#include <QVector>
+
+#include <KPluginFactory>
+#include <KPluginLoader>
+
+namespace {
+const quint32 seed = 42;
+const int photoCount = 3;
+
+// the limits of the stages, a few times what they take on a slow machine,
+// so copying the downloaded file or decoding it twice does not go unnoticed
+const qint64 maxParseTime = 20 * 1000; // us
+const qint64 maxWriteTime = 500; // ms
+const qint64 maxDecodeTime = 1000; // ms
+const qint64 maxPeakResidentSize = 256 * 1024; // kB
+
+// the size of a typical picture of the day, large enough for the stages to be measured
+const QSize pictureSize(1920, 1080);
+
+QDate day()
+{
+    return QDate(2020, 1, 1);
+}
+
+// the name PotdProvider gives the fixture of a transfer
+QString fixtureName(const QUrl &url)
+{
+    return QString::fromLatin1(QCryptographicHash::hash(url.toEncoded(), QCryptographicHash::Sha1).toHex());
+}
+
+QByteArray png(const QSize &size)
+{
+    QImage image(size, QImage::Format_RGB32);
+    image.fill(Qt::darkBlue);
+
+    QByteArray data;
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::WriteOnly);
+    image.save(&buffer, "PNG");
+    return data;
+}
+
+// the photos differ in size only, so the picked one can be told from the image
+QSize photoSize(int index)
+{
+    return QSize(10 + index, 10);
+}
+
+QUrl photoUrl(int index)
+{
+    return QUrl(QStringLiteral("https://live.staticflickr.com/65535/%1_k.jpg").arg(index));
+}
+
+QByteArray testData(const QString &fileName)
+{
+    QFile file(QFINDTESTDATA(QLatin1String("data/") + fileName));
+    return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+}
+
+// the picture of the day Bing offers in resolution @p size
+QUrl bingUrl(const QByteArray &size)
+{
+    return QUrl(QStringLiteral("https://www.bing.com//th?id=OHR.WinterSolstice_EN-US1234567890_%1").arg(QString::fromLatin1(size)));
+}
+}
+
+/**
+ * Runs the providers against fixtures instead of the websites, the way
+ * PLASMA_POTD_REPLAY_DIR does it, and checks the pictures they end up with.
+ */
+class PotdReplayTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void init();
+
+    void pictureOfTheDay_data();
+    void pictureOfTheDay();
+    void bingFallsBackTo1920x1080();
+    void flickrPicksTheSamePhotoEveryRun();
+    void flickrSkipsMissingPhotos();
+
+private:
+    void addFixture(const QUrl &url, const QByteArray &data);
+    void addFlickrList();
+    PotdProvider *createProvider(const QString &plugin, const QVariantList &args);
+    void checkTimings(const PotdProvider::Timings &timings, bool parsed);
+
+    QTemporaryDir m_fixtures;
+};
+
+void PotdReplayTest::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+    QVERIFY(m_fixtures.isValid());
+
+    // read by every provider when it is created
+    qputenv("PLASMA_POTD_REPLAY_DIR", QFile::encodeName(m_fixtures.path()));
+    qputenv("PLASMA_POTD_SEED", QByteArray::number(seed));
+}
+
+void PotdReplayTest::init()
+{
+    QDir(PotdProvider::identifierToPath(QString())).removeRecursively();
+
+    const QStringList fixtures = QDir(m_fixtures.path()).entryList(QDir::Files);
+    for (const QString &fixture : fixtures) {
+        QFile::remove(m_fixtures.filePath(fixture));
+    }
+}
+
+void PotdReplayTest::addFixture(const QUrl &url, const QByteArray &data)
+{
+    QFile file(m_fixtures.filePath(fixtureName(url)));
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    QCOMPARE(file.write(data), qint64(data.size()));
+}
+
+void PotdReplayTest::addFlickrList()
+{
+    QByteArray list = "<?xml version=\"1.0\" encoding=\"utf-8\" ?>\n<rsp stat=\"ok\">\n<photos page=\"1\" pages=\"1\" perpage=\"100\" total=\"3\">\n";
+    for (int i = 0; i < photoCount; ++i) {
+        list += "<photo id=\"" + QByteArray::number(i) + "\" owner=\"1@N01\" ispublic=\"1\" url_k=\""
+            + photoUrl(i).toEncoded() + "\" height_k=\"10\" width_k=\"10\" />\n";
+    }
+    list += "</photos>\n</rsp>\n";
+    addFixture(ProviderUrls::flickrList(day()), list);
+}
+
+PotdProvider *PotdReplayTest::createProvider(const QString &plugin, const QVariantList &args)
+{
+    KPluginFactory *factory = KPluginLoader(plugin).factory();
+    return factory ? factory->create<PotdProvider>(this, args) : nullptr;
+}
+
+void PotdReplayTest::checkTimings(const PotdProvider::Timings &timings, bool parsed)
+{
+    if (parsed) {
+        QVERIFY2(timings.parse >= 0 && timings.parse <= maxParseTime, qPrintable(QString::number(timings.parse)));
+    } else {
+        QCOMPARE(timings.parse, qint64(-1));
+    }
+    QVERIFY2(timings.write >= 0 && timings.write <= maxWriteTime, qPrintable(QString::number(timings.write)));
+    QVERIFY2(timings.decode >= 0 && timings.decode <= maxDecodeTime, qPrintable(QString::number(timings.decode)));
+#ifdef Q_OS_LINUX
+    QVERIFY2(timings.peakResidentSize > 0 && timings.peakResidentSize <= maxPeakResidentSize, qPrintable(QString::number(timings.peakResidentSize)));
+#endif
+}
+
+void PotdReplayTest::pictureOfTheDay_data()
+{
+    QTest::addColumn<QString>("plugin");
+    QTest::addColumn<QString>("name");
+    // the recorded page, none if the picture is fetched directly
+    QTest::addColumn<QUrl>("pageUrl");
+    QTest::addColumn<QString>("page");
+    QTest::addColumn<QUrl>("imageUrl");
+
+    QTest::newRow("apod") << QStringLiteral(APOD_PLUGIN) << QStringLiteral("apod")
+        << ProviderUrls::apod(day()) << QStringLiteral("apod.html")
+        << QUrl(QStringLiteral("http://antwrp.gsfc.nasa.gov/apod/image/2001/BetelgeuseImagined_EsoCalcada_2400.jpg"));
+    // the UHD picture is preferred over the 1920x1080 one of the archive
+    QTest::newRow("bing") << QStringLiteral(BING_PLUGIN) << QStringLiteral("bing")
+        << ProviderUrls::bingArchive(1) << QStringLiteral("bing.json")
+        << bingUrl("UHD.jpg");
+    QTest::newRow("epod") << QStringLiteral(EPOD_PLUGIN) << QStringLiteral("epod")
+        << ProviderUrls::epod() << QStringLiteral("epod.html")
+        << QUrl(QStringLiteral("https://epod.usra.edu/.a/6a0105371bb32c970b0240a4f0c8b4200c-pi"));
+    QTest::newRow("natgeo") << QStringLiteral(NATGEO_PLUGIN) << QStringLiteral("natgeo")
+        << ProviderUrls::natGeo() << QStringLiteral("natgeo.html")
+        << QUrl(QStringLiteral("https://www.nationalgeographic.com/content/dam/photography/photo-of-the-day/2020/01/northern-lights.adapt.1900.1.jpg"));
+    // any white space between the attributes, as the regular expression the provider used before allowed
+    QTest::newRow("natgeo, more white space") << QStringLiteral(NATGEO_PLUGIN) << QStringLiteral("natgeo")
+        << ProviderUrls::natGeo() << QStringLiteral("natgeo-whitespace.html")
+        << QUrl(QStringLiteral("https://www.nationalgeographic.com/content/dam/photography/photo-of-the-day/2020/01/northern-lights.adapt.1900.1.jpg"));
+    QTest::newRow("noaa") << QStringLiteral(NOAA_PLUGIN) << QStringLiteral("noaa")
+        << ProviderUrls::noaa() << QStringLiteral("noaa.html")
+        << QUrl(QStringLiteral("https://www.nesdis.noaa.gov/sites/default/files/GOES16_Hurricane_2019.jpg"));
+    QTest::newRow("unsplash") << QStringLiteral(UNSPLASH_PLUGIN) << QStringLiteral("unsplash")
+        << QUrl() << QString()
+        << ProviderUrls::unsplashDaily(QStringLiteral("1065976"));
+    QTest::newRow("wikimedia") << QStringLiteral(WCPOTD_PLUGIN) << QStringLiteral("wcpotd")
+        << ProviderUrls::wikimedia() << QStringLiteral("wikimedia.json")
+        << QUrl(QStringLiteral("https://commons.wikimedia.org/wiki/Special:FilePath/Sunrise_over_the_Alps_from_Zugspitze.jpg"));
+}
+
+void PotdReplayTest::pictureOfTheDay()
+{
+    QFETCH(QString, plugin);
+    QFETCH(QString, name);
+    QFETCH(QUrl, pageUrl);
+    QFETCH(QString, page);
+    QFETCH(QUrl, imageUrl);
+
+    if (!page.isEmpty()) {
+        const QByteArray data = testData(page);
+        QVERIFY(!data.isEmpty());
+        addFixture(pageUrl, data);
+    }
+    addFixture(imageUrl, png(pictureSize));
+
+    QScopedPointer<PotdProvider> provider(createProvider(plugin, { name, day().toString(Qt::ISODate) }));
+    QVERIFY(provider);
+    QSignalSpy finished(provider.data(), &PotdProvider::finished);
+    QSignalSpy error(provider.data(), &PotdProvider::error);
+
+    QTRY_VERIFY(!finished.isEmpty() || !error.isEmpty());
+    QCOMPARE(finished.count(), 1);
+    QCOMPARE(provider->image().size(), pictureSize);
+    QCOMPARE(provider->localPath(), PotdProvider::identifierToPath(name + QLatin1String(":2020-01-01")));
+    checkTimings(provider->timings(), !page.isEmpty());
+}
+
+void PotdReplayTest::bingFallsBackTo1920x1080()
+{
+    // not every picture is offered in UHD
+    addFixture(ProviderUrls::bingArchive(1), testData(QStringLiteral("bing.json")));
+    addFixture(bingUrl("1920x1080.jpg&rf=LaDigue_1920x1080.jpg&pid=hp"), png(pictureSize));
+
+    QScopedPointer<PotdProvider> provider(createProvider(QStringLiteral(BING_PLUGIN), { QStringLiteral("bing"), day().toString(Qt::ISODate) }));
+    QVERIFY(provider);
+    QSignalSpy finished(provider.data(), &PotdProvider::finished);
+    QSignalSpy error(provider.data(), &PotdProvider::error);
+
+    QTRY_VERIFY(!finished.isEmpty() || !error.isEmpty());
+    QCOMPARE(finished.count(), 1);
+    QCOMPARE(provider->image().size(), pictureSize);
+    checkTimings(provider->timings(), true);
+}
+
+void PotdReplayTest::flickrPicksTheSamePhotoEveryRun()
+{
+    addFlickrList();
+    for (int i = 0; i < photoCount; ++i) {
+        addFixture(photoUrl(i), png(photoSize(i)));
+    }
+
+    const int expected = QRandomGenerator(seed).bounded(photoCount);
+
+    // the second run reads the list from the cache instead of the fixture
+    for (int run = 0; run < 2; ++run) {
+        QScopedPointer<PotdProvider> provider(createProvider(QStringLiteral(FLICKR_PLUGIN), { QStringLiteral("flickr"), day().toString(Qt::ISODate) }));
+        QVERIFY(provider);
+        QSignalSpy finished(provider.data(), &PotdProvider::finished);
+        QSignalSpy error(provider.data(), &PotdProvider::error);
+
+        QTRY_VERIFY(!finished.isEmpty() || !error.isEmpty());
+        QCOMPARE(finished.count(), 1);
+        QCOMPARE(provider->image().size(), photoSize(expected));
+    }
+}
+
+void PotdReplayTest::flickrSkipsMissingPhotos()
+{
+    // the photo picked first cannot be downloaded, so the provider picks another one
+    QRandomGenerator random(seed);
+    QVector<int> photos;
+    for (int i = 0; i < photoCount; ++i) {
+        photos << i;
+    }
+    const int missing = photos.takeAt(random.bounded(photos.size()));
+    const int expected = photos.at(random.bounded(photos.size()));
+
+    addFlickrList();
+    for (int i = 0; i < photoCount; ++i) {
+        if (i != missing) {
+            addFixture(photoUrl(i), png(photoSize(i)));
+        }
+    }
+
+    QScopedPointer<PotdProvider> provider(createProvider(QStringLiteral(FLICKR_PLUGIN), { QStringLiteral("flickr"), day().toString(Qt::ISODate) }));
+    QVERIFY(provider);
+    QSignalSpy finished(provider.data(), &PotdProvider::finished);
+    QSignalSpy error(provider.data(), &PotdProvider::error);
+
+    QTRY_VERIFY(!finished.isEmpty() || !error.isEmpty());
+    QCOMPARE(finished.count(), 1);
+    QCOMPARE(provider->image().size(), photoSize(expected));
+}
+
+QTEST_MAIN(PotdReplayTest)
+
+#include "potdreplaytest.moc"
@@ -18,76 +18,58 @@
  */
 
 #include "bingprovider.h"
+#include "potdparser.h"
+#include "providerurls.h"
 
-#include <QJsonDocument>
-#include <QJsonArray>
 #include <QDebug>
+#include <QUrl>
 
 #include <KPluginFactory>
-#include <KIO/Job>
 
 BingProvider::BingProvider(QObject* parent, const QVariantList& args)
     : PotdProvider(parent, args)
 {
-    const QUrl url(QStringLiteral("https://www.bing.com/HPImageArchive.aspx?format=js&idx=0&n=1"));
-
-    KIO::StoredTransferJob* job = KIO::storedGet(url, KIO::NoReload, KIO::HideProgressInfo);
-    connect(job, &KIO::StoredTransferJob::finished, this, &BingProvider::pageRequestFinished);
-}
-
-BingProvider::~BingProvider() = default;
-
-QImage BingProvider::image() const
-{
-    return mImage;
-}
-
-void BingProvider::pageRequestFinished(KJob* _job)
-{
-    KIO::StoredTransferJob* job = static_cast<KIO::StoredTransferJob*>(_job);
-    if (job->error()) {
-        emit error(this);
+    if (isBatch()) {
+        // the archive never returns more than eight pictures
+        const QUrl url = ProviderUrls::bingArchive(8);
+        fetch(url, [this](const QByteArray &data) {
+            QList<QUrl> urls;
+            const QList<QByteArray> images = PotdParser::jsonValues(data, "images/*/url");
+            for (const QByteArray &url : images) {
+                if (!url.isEmpty()) {
+                    urls << QUrl(QStringLiteral("https://www.bing.com/%1").arg(QString::fromUtf8(url)));
+                }
+            }
+            fetchImages(urls);
+        });
         return;
     }
 
-    auto json = QJsonDocument::fromJson(job->data());
-    do {
-        if (json.isNull()) {
-            break;
-        }
-        auto imagesArray = json.object().value(QLatin1String("images"));
-        if (!imagesArray.isArray() || imagesArray.toArray().size() <= 0) {
-            break;
-        }
-        auto imageObj = imagesArray.toArray().at(0);
-        if (!imageObj.isObject()) {
-            break;
+    const QUrl url = ProviderUrls::bingArchive(1);
+
+    fetch(url, [this](const QByteArray &data) {
+        const QByteArray url = PotdParser::jsonValue(data, "images/0/url");
+        if (url.isEmpty()) {
+            qDebug() << "no image found in the archive";
+            emit error(this);
+            return;
         }
-        auto url = imageObj.toObject().value(QLatin1String("url"));
-        if (!url.isString() || url.toString().isEmpty()) {
-            break;
+
+        // the same picture is offered in a few fixed resolutions, named after urlbase;
+        // not every picture has the UHD one, the url of the archive is 1920x1080
+        QList<QUrl> urls;
+        const QByteArray urlBase = PotdParser::jsonValue(data, "images/0/urlbase");
+        if (!urlBase.isEmpty()) {
+            urls << QUrl(QStringLiteral("https://www.bing.com/%1_UHD.jpg").arg(QString::fromUtf8(urlBase)));
+            requestPreview(QUrl(QStringLiteral("https://www.bing.com/%1_400x240.jpg").arg(QString::fromUtf8(urlBase))));
         }
-        QUrl picUrl(QStringLiteral("https://www.bing.com/%1").arg(url.toString()));
-        KIO::StoredTransferJob* imageJob = KIO::storedGet(picUrl, KIO::NoReload, KIO::HideProgressInfo);
-        connect(imageJob, &KIO::StoredTransferJob::finished, this, &BingProvider::imageRequestFinished);
-        return;
-    } while (0);
+        urls << QUrl(QStringLiteral("https://www.bing.com/%1").arg(QString::fromUtf8(url)));
 
-    emit error(this);
-    return;
+        fetchImage(urls);
+    });
 }
 
-void BingProvider::imageRequestFinished(KJob* _job)
-{
-    KIO::StoredTransferJob* job = static_cast<KIO::StoredTransferJob*>(_job);
-    if (job->error()) {
-        emit error(this);
-        return;
-    }
-    QByteArray data = job->data();
-    mImage = QImage::fromData(data);
-    emit finished(this);
-}
+BingProvider::~BingProvider() = default;
 
 K_PLUGIN_CLASS_WITH_JSON(BingProvider, "bingprovider.json")
 
@@ -24,8 +24,6 @@
 // Qt
 #include <QImage>
 
-class KJob;
-
 /**
  * This class provides the image for the Bing's homepage
  * url is obtained from https://www.bing.com/HPImageArchive.aspx?format=js&idx=0&n=1
@@ -47,21 +45,6 @@ class BingProvider : public PotdProvider
          * Destroys the Bing provider.
          */
         ~BingProvider() override;
-
-        /**
-         * Returns the requested image.
-         *
-         * Note: This method returns only a valid image after the
-         *       finished() signal has been emitted.
-         */
-        QImage image() const override;
-
-    private:
-        void pageRequestFinished(KJob *job);
-        void imageRequestFinished(KJob *job);
-
-    private:
-        QImage mImage;
 };
 
 #endif
@@ -18,83 +18,256 @@
  */
 
 #include "cachedprovider.h"
+#include "debug.h"
 
+#include <QDir>
 #include <QFile>
 #include <QFileInfo>
-#include <QTimer>
-#include <QThreadPool>
-#include <QStandardPaths>
-#include <QDir>
 #include <QDateTime>
+#include <QElapsedTimer>
+#include <QImageReader>
 #include <QRegularExpression>
+#include <QSaveFile>
 
 #include <QDebug>
 
-LoadImageThread::LoadImageThread(const QString &filePath)
-    : m_filePath(filePath)
+#include <imageops.h>
+
+#include <algorithm>
+
+namespace {
+// wallpapers are often far larger than any screen, so they are brought down to
+// the size they are shown at here, rather than on every paint in the GUI thread
+QImage prepareForDisplay(const QImage &image, const QSize &maxSize)
+{
+    if (maxSize.isValid()) {
+        const QSize size = image.size().scaled(maxSize, Qt::KeepAspectRatioByExpanding);
+        if (size.width() < image.width()) {
+            return ImageOps::downscaled(image, size);
+        }
+    }
+    return ImageOps::toDisplayFormat(image);
+}
+
+// the backdrop is blurred so much that it can be this small and still be
+// scaled up to any screen size
+const QSize backdropSize(320, 320);
+const int backdropRadius = 6;
+}
+
+ImageQueue::ImageQueue()
+    : m_head(nullptr)
+{
+}
+
+ImageQueue::~ImageQueue()
+{
+    takeAll();
+}
+
+void ImageQueue::push( Kind kind, const QString &source, const QString &path, const QImage &image )
+{
+    Node *node = new Node{ { kind, source, path, image }, nullptr };
+    Node *head;
+    do {
+        head = m_head.loadAcquire();
+        node->next = head;
+    } while (!m_head.testAndSetRelease(head, node));
+
+    if (!head) {
+        emit ready();
+    }
+}
+
+QVector<ImageQueue::Entry> ImageQueue::takeAll()
+{
+    // detaching the whole list at once means nodes are never popped
+    // individually, which keeps the queue free of the ABA problem
+    Node *node = m_head.fetchAndStoreAcquire(nullptr);
+
+    QVector<Entry> entries;
+    while (node) {
+        entries.append(node->entry);
+        Node *next = node->next;
+        delete node;
+        node = next;
+    }
+
+    // the list is newest first
+    std::reverse(entries.begin(), entries.end());
+    return entries;
+}
+
+LoadImageThread::LoadImageThread(const QSharedPointer<ImageQueue> &queue, ImageQueue::Kind kind,
+                                 const QString &source, const QString &filePath, const QSize &maxSize)
+    : m_queue(queue),
+      m_kind(kind),
+      m_source(source),
+      m_filePath(filePath),
+      m_maxSize(maxSize)
 {
 }
 
 void LoadImageThread::run()
 {
-    QImage image;
-    image.load(m_filePath );
-    emit done(image);
+    QImageReader reader(m_filePath);
+    if (m_maxSize.isValid() && reader.supportsOption(QImageIOHandler::ScaledSize)) {
+        const QSize size = reader.size().scaled(m_maxSize, Qt::KeepAspectRatioByExpanding);
+        if (size.width() < reader.size().width()) {
+            // lets e.g. the JPEG decoder skip most of the work
+            reader.setScaledSize(size);
+        }
+    }
+    m_queue->push(m_kind, m_source, m_filePath, prepareForDisplay(reader.read(), m_maxSize));
 }
 
-SaveImageThread::SaveImageThread(const QString &identifier, const QImage &image)
-    : m_image(image),
-      m_identifier(identifier)
+ScaleImageThread::ScaleImageThread(const QSharedPointer<ImageQueue> &queue, ImageQueue::Kind kind,
+                                   const QString &source, const QString &filePath, const QImage &image, const QSize &maxSize)
+    : m_queue(queue),
+      m_kind(kind),
+      m_source(source),
+      m_filePath(filePath),
+      m_image(image),
+      m_maxSize(maxSize)
 {
 }
 
-void SaveImageThread::run()
+void ScaleImageThread::run()
 {
-    const QString path = CachedProvider::identifierToPath( m_identifier );
-    m_image.save(path, "PNG");
-    emit done( m_identifier, path, m_image );
+    QElapsedTimer timer;
+    timer.start();
+    const QImage image = prepareForDisplay(m_image, m_maxSize);
+    qCDebug(POTD_DEBUG) << m_source << "preparing" << m_image.size() << "for display took" << timer.elapsed() << "ms";
+    m_queue->push(m_kind, m_source, m_filePath, image);
 }
 
-QString CachedProvider::identifierToPath( const QString &identifier )
+BackdropThread::BackdropThread(const QSharedPointer<ImageQueue> &queue, const QString &source,
+                               const QString &filePath, const QImage &image)
+    : m_queue(queue),
+      m_source(source),
+      m_filePath(filePath),
+      m_image(image)
 {
-    const QString dataDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QLatin1String("/plasma_engine_potd/");
-    QDir d;
-    d.mkpath(dataDir);
-    return dataDir + identifier;
 }
 
+void BackdropThread::run()
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    const QString path = m_filePath + QLatin1String(".backdrop");
+    const QFileInfo info(path);
+    if (info.exists() && info.lastModified() >= QFileInfo(m_filePath).lastModified()) {
+        QImage backdrop(path);
+        if (!backdrop.isNull()) {
+            m_queue->push(ImageQueue::Backdrop, m_source, path, ImageOps::toDisplayFormat(backdrop));
+            return;
+        }
+    }
+
+    const QImage small = ImageOps::downscaled(m_image, m_image.size().scaled(backdropSize, Qt::KeepAspectRatioByExpanding));
+    const QImage backdrop = ImageOps::blurred(small, backdropRadius);
+
+    QSaveFile file(path);
+    if (file.open(QIODevice::WriteOnly) && backdrop.save(&file, "PNG")) {
+        file.commit();
+    }
+    qCDebug(POTD_DEBUG) << m_source << "creating the backdrop took" << timer.elapsed() << "ms";
+    m_queue->push(ImageQueue::Backdrop, m_source, path, backdrop);
+}
+
+SaveImageThread::SaveImageThread(const QSharedPointer<ImageQueue> &queue, const QString &identifier, const QImage &image,
+                                 ImageQueue::Kind kind, const QSize &maxSize)
+    : m_queue(queue),
+      m_kind(kind),
+      m_image(image),
+      m_identifier(identifier),
+      m_maxSize(maxSize)
+{
+}
 
-CachedProvider::CachedProvider( const QString &identifier, QObject *parent )
-    : PotdProvider( parent ), mIdentifier( identifier )
+void SaveImageThread::run()
 {
-    LoadImageThread *thread = new LoadImageThread( identifierToPath( mIdentifier ) );
-    connect(thread, SIGNAL(done(QImage)), this, SLOT(triggerFinished(QImage)));
-    QThreadPool::globalInstance()->start(thread);
+    QElapsedTimer timer;
+    timer.start();
+
+    const QString path = PotdProvider::identifierToPath( m_identifier );
+    // never leave a half written file behind when interrupted
+    QSaveFile file(path);
+    if (file.open(QIODevice::WriteOnly) && m_image.save(&file, "PNG")) {
+        file.commit();
+    }
+    qCDebug(POTD_DEBUG) << m_identifier << "writing the cache took" << timer.elapsed() << "ms";
+    m_queue->push( m_kind, m_identifier, path, prepareForDisplay( m_image, m_maxSize ) );
 }
 
-CachedProvider::~CachedProvider()
+PruneCacheThread::PruneCacheThread(int maxAge)
+    : m_maxAge(maxAge)
 {
 }
 
-QImage CachedProvider::image() const
+void PruneCacheThread::run()
 {
-    return mImage;
+    QElapsedTimer timer;
+    timer.start();
+
+    const QDateTime oldest = QDateTime::currentDateTime().addDays(-m_maxAge);
+    const QDir dir(PotdProvider::identifierToPath(QString()));
+    // pictures are never removed, the dated ones may be what somebody has chosen
+    // to keep, while everything derived from them is recreated when needed
+    const QStringList nameFilters{ QStringLiteral("flickr.list:*"), QStringLiteral("*.backdrop") };
+    const QFileInfoList entries = dir.entryInfoList(nameFilters, QDir::Files);
+    int removed = 0;
+    for (const QFileInfo &entry : entries) {
+        if (entry.lastModified() < oldest && QFile::remove(entry.absoluteFilePath())) {
+            ++removed;
+        }
+    }
+    qCDebug(POTD_DEBUG) << "removed" << removed << "of" << entries.count() << "cached files in" << timer.elapsed() << "ms";
 }
 
-QString CachedProvider::identifier() const
+QString CachedProvider::previewPath( const QString &identifier )
 {
-    return mIdentifier;
+    QRegularExpression re(QLatin1String(":(\\d{4}-\\d{2}-\\d{2})"));
+    const QRegularExpressionMatch match = re.match(identifier);
+    if (!match.hasMatch()) {
+        // a daily without any cached picture, there is nothing older to show
+        return QString();
+    }
+
+    const QDate date = QDate::fromString(match.captured(1), Qt::ISODate);
+    if (!date.isValid()) {
+        return QString();
+    }
+
+    QString previousIdentifier = identifier;
+    previousIdentifier.replace(match.capturedStart(1), match.capturedLength(1), date.addDays(-1).toString(Qt::ISODate));
+    const QString path = PotdProvider::identifierToPath( previousIdentifier );
+    return QFile::exists( path ) ? path : QString();
 }
 
-void CachedProvider::triggerFinished(const QImage &image)
+QStringList CachedProvider::batchPaths( const QString &identifier )
 {
-    mImage = image;
-    emit finished( this );
+    QStringList paths;
+    const QString path = PotdProvider::identifierToPath( identifier );
+    QFile list( path + QLatin1String(".list") );
+    if ( !list.open( QIODevice::ReadOnly ) ) {
+        return paths;
+    }
+
+    const QString dir = QFileInfo( path ).absolutePath() + QLatin1Char('/');
+    while ( !list.atEnd() ) {
+        const QString entry = dir + QFile::decodeName( list.readLine().trimmed() );
+        if ( QFile::exists( entry ) ) {
+            paths << entry;
+        }
+    }
+    return paths;
 }
 
 bool CachedProvider::isCached( const QString &identifier, bool ignoreAge )
 {
-    const QString path = identifierToPath( identifier );
+    const QString path = PotdProvider::identifierToPath( identifier );
     if (!QFile::exists( path ) ) {
         return false;
     }
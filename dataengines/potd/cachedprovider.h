@@ -20,92 +20,191 @@
 #ifndef CACHEDPROVIDER_H
 #define CACHEDPROVIDER_H
 
+#include <QAtomicPointer>
 #include <QImage>
 #include <QRunnable>
+#include <QSharedPointer>
+#include <QStringList>
+#include <QVector>
 
 #include "potdprovider.h"
 
 /**
- * This class provides pictures from the local cache.
+ * This class provides access to the pictures in the local cache.
  */
-class CachedProvider : public PotdProvider
+class CachedProvider
 {
-    Q_OBJECT
-
     public:
         /**
-         * Creates a new cached provider.
-         *
-         * @param identifier The identifier of the cached picture.
-         * @param parent The parent object.
-         */
-        CachedProvider( const QString &identifier, QObject *parent );
-
-        /**
-         * Destroys the cached provider.
+         * Returns whether a picture with the given @p identifier is cached.
          */
-        ~CachedProvider() override;
+        static bool isCached( const QString &identifier, bool ignoreAge = false );
 
         /**
-         * Returns the requested image.
-         *
-         * Note: This method returns only a valid image after the
-         *       finished() signal has been emitted.
+         * Returns the path of a cached picture which can be shown as a preview
+         * while the picture for @p identifier is fetched, or an empty string.
+         * For dated identifiers this is the picture of the previous day.
          */
-        QImage image() const override;
+        static QString previewPath( const QString &identifier );
 
         /**
-         * Returns the identifier of the picture request (name + date).
+         * Returns the paths of all cached pictures of the batch request
+         * @p identifier, or an empty list if it is not a batch request.
          */
-        QString identifier() const override;
+        static QStringList batchPaths( const QString &identifier );
+};
 
-        /**
-         * Returns whether a picture with the given @p identifier is cached.
-         */
-        static bool isCached( const QString &identifier, bool ignoreAge = false );
+/**
+ * Hands images over from the worker threads to the engine.
+ *
+ * Any number of threads may push() concurrently without taking a lock;
+ * the engine takes everything pushed so far with takeAll(), so all
+ * images which arrive within one event loop turn are published together.
+ */
+class ImageQueue : public QObject
+{
+    Q_OBJECT
 
-        /**
-         * Returns a path for the given identifier
-         */
-        static QString identifierToPath( const QString &identifier );
+public:
+    enum Kind {
+        Cached,     ///< loaded from the cache when a source is requested
+        Fetched,    ///< freshly fetched and stored in the cache
+        Preview,    ///< shown until the full picture is there
+        Fallback,   ///< older picture shown because fetching failed
+        Prefetched, ///< stored ahead of the day change, not shown yet
+        Backdrop    ///< blurred picture to show behind one which does not fill the screen
+    };
+
+    struct Entry {
+        Kind kind;
+        QString source;
+        QString path;
+        QImage image;
+    };
+
+    ImageQueue();
+    ~ImageQueue() override;
+
+    /**
+     * Adds an image, may be called from any thread.
+     */
+    void push( Kind kind, const QString &source, const QString &path, const QImage &image );
+
+    /**
+     * Removes and returns all images in the order they were pushed.
+     */
+    QVector<Entry> takeAll();
 
-    private Q_SLOTS:
-        void triggerFinished(const QImage &image);
+Q_SIGNALS:
+    /**
+     * Emitted by push() when the queue was empty, so there is only
+     * one pending notification no matter how many images arrive.
+     */
+    void ready();
 
-    private:
-        QString mIdentifier;
-        QImage mImage;
+private:
+    struct Node {
+        Entry entry;
+        Node *next;
+    };
+    QAtomicPointer<Node> m_head;
 };
 
-class LoadImageThread : public QObject, public QRunnable
+class LoadImageThread : public QRunnable
 {
-    Q_OBJECT
-
 public:
-    explicit LoadImageThread(const QString &filePath);
+    /**
+     * @param maxSize if valid, the image is decoded scaled down until it just covers it
+     */
+    LoadImageThread(const QSharedPointer<ImageQueue> &queue, ImageQueue::Kind kind,
+                    const QString &source, const QString &filePath, const QSize &maxSize = QSize());
     void run() override;
 
-Q_SIGNALS:
-    void done(const QImage &pixmap);
+private:
+    QSharedPointer<ImageQueue> m_queue;
+    ImageQueue::Kind m_kind;
+    QString m_source;
+    QString m_filePath;
+    QSize m_maxSize;
+};
+
+/**
+ * Prepares an image which has already been decoded for display.
+ */
+class ScaleImageThread : public QRunnable
+{
+public:
+    /**
+     * @param maxSize if valid, the image is scaled down until it just covers it
+     */
+    ScaleImageThread(const QSharedPointer<ImageQueue> &queue, ImageQueue::Kind kind,
+                     const QString &source, const QString &filePath, const QImage &image, const QSize &maxSize);
+    void run() override;
 
 private:
+    QSharedPointer<ImageQueue> m_queue;
+    ImageQueue::Kind m_kind;
+    QString m_source;
     QString m_filePath;
+    QImage m_image;
+    QSize m_maxSize;
 };
 
-class SaveImageThread : public QObject, public QRunnable
+/**
+ * Creates the blurred backdrop of an image, or loads it from the cache.
+ */
+class BackdropThread : public QRunnable
 {
-    Q_OBJECT
+public:
+    /**
+     * @param source the source the backdrop is published as
+     * @param filePath the cache file of @p image, the backdrop is cached next to it
+     */
+    BackdropThread(const QSharedPointer<ImageQueue> &queue, const QString &source,
+                   const QString &filePath, const QImage &image);
+    void run() override;
 
+private:
+    QSharedPointer<ImageQueue> m_queue;
+    QString m_source;
+    QString m_filePath;
+    QImage m_image;
+};
+
+/**
+ * Removes the lists and backdrops kept next to the pictures in the cache
+ * which have not been written for a while. The pictures themselves stay.
+ */
+class PruneCacheThread : public QRunnable
+{
 public:
-    SaveImageThread(const QString &identifier, const QImage &image);
+    /**
+     * @param maxAge the number of days after which a file is removed
+     */
+    explicit PruneCacheThread(int maxAge);
     void run() override;
 
-Q_SIGNALS:
-    void done( const QString &source, const QString &path, const QImage &img );
+private:
+    int m_maxAge;
+};
+
+class SaveImageThread : public QRunnable
+{
+public:
+    /**
+     * @param maxSize if valid, the published image is scaled down until it just covers it,
+     *                the cache always keeps the image as it is
+     */
+    SaveImageThread(const QSharedPointer<ImageQueue> &queue, const QString &identifier, const QImage &image,
+                    ImageQueue::Kind kind = ImageQueue::Fetched, const QSize &maxSize = QSize());
+    void run() override;
 
 private:
+    QSharedPointer<ImageQueue> m_queue;
+    ImageQueue::Kind m_kind;
     QImage m_image;
     QString m_identifier;
+    QSize m_maxSize;
 };
 
 #endif
@@ -25,8 +25,6 @@
 // Qt
 #include <QImage>
 
-class KJob;
-
 /**
  * This class provides the image for EPOD 
  * "Earth Science Picture Of the Day"
@@ -49,21 +47,6 @@ class EpodProvider : public PotdProvider
          * Destroys the EPOD provider.
          */
         ~EpodProvider() override;
-
-        /**
-         * Returns the requested image.
-         *
-         * Note: This method returns only a valid image after the
-         *       finished() signal has been emitted.
-         */
-        QImage image() const override;
-
-    private:
-        void pageRequestFinished(KJob *job);
-        void imageRequestFinished(KJob *job);
-
-    private:
-        QImage mImage;
 };
 
 #endif
@@ -20,28 +20,25 @@
  */
 
 #include "flickrprovider.h"
+#include "potdparser.h"
+#include "providerurls.h"
 
-#include <QUrlQuery>
+#include <QFile>
+#include <QSaveFile>
 #include <QDebug>
 #include <QRandomGenerator>
 #include <KPluginFactory>
-#include <KIO/Job>
 
-#define FLICKR_API_KEY QStringLiteral("11829a470557ad8e10b02e80afacb3af")
+// the list has up to 500 entries, far more than anybody looks at in a day
+static const int maxBatchSize = 20;
+// the number of photos which are tried before giving up
+static const int maxImageFailures = 3;
 
+// the interestingness list of a date never changes, so it is kept next to the pictures
 static
-QUrl buildUrl(const QDate &date)
+QString listPath(const QDate &date)
 {
-    QUrl url(QLatin1String( "https://api.flickr.com/services/rest/"));
-    QUrlQuery urlQuery(url);
-    urlQuery.addQueryItem(QStringLiteral("api_key"), FLICKR_API_KEY);
-    urlQuery.addQueryItem(QStringLiteral("method"), QStringLiteral("flickr.interestingness.getList"));
-    urlQuery.addQueryItem(QStringLiteral("date"), date.toString(Qt::ISODate));
-    // url_o might be either too small or too large.
-    urlQuery.addQueryItem(QStringLiteral("extras"), QStringLiteral("url_k,url_h,url_o"));
-    url.setQuery(urlQuery);
-
-    return url;
+    return PotdProvider::identifierToPath(QStringLiteral("flickr.list:%1").arg(date.toString(Qt::ISODate)));
 }
 
 FlickrProvider::FlickrProvider(QObject *parent, const QVariantList &args)
@@ -49,115 +46,150 @@ FlickrProvider::FlickrProvider(QObject *parent, const QVariantList &args)
 {
     mActualDate = date();
 
-    const QUrl url = buildUrl(mActualDate);
-
-    KIO::StoredTransferJob *job = KIO::storedGet(url, KIO::NoReload, KIO::HideProgressInfo);
-    connect(job, &KIO::StoredTransferJob::finished, this, &FlickrProvider::pageRequestFinished);
+    requestList();
 }
 
 FlickrProvider::~FlickrProvider() = default;
 
-QImage FlickrProvider::image() const
+void FlickrProvider::requestList()
 {
-    return mImage;
+    if (readList()) {
+        listReady();
+        return;
+    }
+
+    fetch(ProviderUrls::flickrList(mActualDate), [this](const QByteArray &data) {
+        pageRequestFinished(data);
+    });
 }
 
-void FlickrProvider::pageRequestFinished(KJob *_job)
+bool FlickrProvider::readList()
 {
-    KIO::StoredTransferJob *job = static_cast<KIO::StoredTransferJob *>( _job );
-    if (job->error()) {
-        emit error(this);
-        qDebug() << "pageRequestFinished error";
+    QFile file(listPath(mActualDate));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    // one photo per line: the id, the best url and the url of the preview, if any
+    m_photos.clear();
+    while (!file.atEnd()) {
+        const QList<QByteArray> fields = file.readLine().trimmed().split(' ');
+        if (fields.count() < 2) {
+            continue;
+        }
+        m_photos.append({ fields.at(0), fields.at(1), fields.value(2) });
+    }
+    return !m_photos.isEmpty();
+}
+
+void FlickrProvider::writeList() const
+{
+    QSaveFile file(listPath(mActualDate));
+    if (!file.open(QIODevice::WriteOnly)) {
         return;
     }
 
-    const QString data = QString::fromUtf8( job->data() );
+    for (const Photo &photo : m_photos) {
+        file.write(photo.id + ' ' + photo.url + ' ' + photo.previewUrl + '\n');
+    }
+    file.commit();
+}
 
+void FlickrProvider::pageRequestFinished(const QByteArray &data)
+{
     // Clear the list
-    m_photoList.clear();
-
-    xml.clear();
-    xml.addData(data);
-
-    while (!xml.atEnd()) {
-        xml.readNext();
-
-        if (xml.isStartElement()) {
-            auto attributes = xml.attributes();
-            if (xml.name() == QLatin1String("rsp")) {
-                const int maxFailure = 5;
-                /* no pictures available for the specified parameters */
-                if (attributes.value ( QLatin1String( "stat" ) ).toString() != QLatin1String( "ok" )) {
-                    if (mFailureNumber < maxFailure) {
-                        /* To be sure, decrement the date to two days earlier... @TODO */
-                        mActualDate = mActualDate.addDays(-2);
-                        QUrl url = buildUrl(mActualDate);
-                        KIO::StoredTransferJob *pageJob = KIO::storedGet(url, KIO::NoReload, KIO::HideProgressInfo);
-                        connect(pageJob, &KIO::StoredTransferJob::finished, this, &FlickrProvider::pageRequestFinished);
-                        mFailureNumber++;
-                        return;
-                    } else {
-                        emit error(this);
-                        qDebug() << "pageRequestFinished error";
-                        return;
-                    }
-                }
-            } else if (xml.name() == QLatin1String( "photo" )) {
-                if (attributes.value ( QLatin1String( "ispublic" ) ).toString() != QLatin1String( "1" )) {
-                    continue;
-                }
-
-                const char *fallbackList[] = {
-                    "url_k", "url_h"
-                };
-
-                bool found = false;
-                for (auto urlAttr : fallbackList) {
-                    // Get the best url.
-                    QLatin1String urlAttrString(urlAttr);
-                    if (attributes.hasAttribute(urlAttrString)) {
-                        m_photoList.append(attributes.value(urlAttrString).toString());
-                        found = true;
-                        break;
-                    }
-                }
-
-                // The logic here is, if url_h or url_k are present, url_o must
-                // has higher quality, otherwise, url_o is worse than k/h size.
-                // If url_o is better, prefer url_o.
-                if (found) {
-                    QLatin1String originAttr("url_o");
-                    if (attributes.hasAttribute(originAttr)) {
-                        m_photoList.back() = attributes.value(QLatin1String(originAttr)).toString();
-                    }
-                }
-            }
+    m_photos.clear();
+
+    QByteArray stat;
+    PotdParser::forEachXmlElement(data, "rsp", [&stat](const PotdParser::XmlAttributes &attributes) {
+        stat = attributes.value("stat");
+        return false;
+    });
+
+    /* no pictures available for the specified parameters */
+    if (stat != "ok") {
+        const int maxFailure = 5;
+        if (mFailureNumber < maxFailure) {
+            /* To be sure, decrement the date to two days earlier... @TODO */
+            mActualDate = mActualDate.addDays(-2);
+            mFailureNumber++;
+            requestList();
+        } else {
+            emit error(this);
+            qDebug() << "pageRequestFinished error";
         }
+        return;
     }
 
-    if (xml.error() && xml.error() != QXmlStreamReader::PrematureEndOfDocumentError) {
-        qWarning() << "XML ERROR:" << xml.lineNumber() << ": " << xml.errorString();
-    }
+    PotdParser::forEachXmlElement(data, "photo", [this](const PotdParser::XmlAttributes &attributes) {
+        if (attributes.value("ispublic") != "1") {
+            return true;
+        }
 
-    if (m_photoList.begin() != m_photoList.end()) {
-        QUrl url( m_photoList.at(QRandomGenerator::global()->bounded(m_photoList.size())) );
-            KIO::StoredTransferJob *imageJob = KIO::storedGet(url, KIO::NoReload, KIO::HideProgressInfo);
-            connect(imageJob, &KIO::StoredTransferJob::finished, this, &FlickrProvider::imageRequestFinished);
-    } else {
-        qDebug() << "empty list";
+        // Get the best url.
+        QByteArray url = attributes.value("url_k");
+        if (url.isEmpty()) {
+            url = attributes.value("url_h");
+        }
+
+        // The logic here is, if url_h or url_k are present, url_o must
+        // has higher quality, otherwise, url_o is worse than k/h size.
+        // If url_o is better, prefer url_o.
+        const QByteArray id = attributes.value("id");
+        if (!url.isEmpty() && !id.isEmpty()) {
+            const QByteArray original = attributes.value("url_o");
+            m_photos.append({ id, original.isEmpty() ? url : original, attributes.value("url_m") });
+        }
+        return true;
+    });
+
+    if (!m_photos.isEmpty()) {
+        writeList();
     }
+    listReady();
 }
 
-void FlickrProvider::imageRequestFinished(KJob *_job)
+void FlickrProvider::listReady()
 {
-    KIO::StoredTransferJob *job = static_cast<KIO::StoredTransferJob *>( _job );
-    if ( job->error() ) {
+    if (m_photos.isEmpty()) {
+        qDebug() << "empty list";
         emit error(this);
         return;
     }
 
-    mImage = QImage::fromData( job->data() );
-    emit finished(this);
+    if (isBatch()) {
+        // the list is ordered by interestingness, so the first ones are the best
+        QList<QUrl> urls;
+        for (int i = 0; i < qMin(m_photos.size(), maxBatchSize); i++) {
+            urls << QUrl(QString::fromUtf8(m_photos.at(i).url));
+        }
+        fetchImages(urls);
+        return;
+    }
+
+    const int index = randomGenerator()->bounded(m_photos.size());
+    const Photo &photo = m_photos.at(index);
+    if (!photo.previewUrl.isEmpty()) {
+        requestPreview(QUrl(QString::fromUtf8(photo.previewUrl)));
+    }
+
+    fetchPhoto(index);
+}
+
+void FlickrProvider::fetchPhoto(int index)
+{
+    const QUrl url(QString::fromUtf8(m_photos.at(index).url));
+    fetchImage(url, [this, index]() {
+        // photos get deleted or made private after they made it into the list,
+        // any other one of the day is as good
+        m_photos.remove(index);
+        if (m_photos.isEmpty() || ++mImageFailureNumber >= maxImageFailures) {
+            emit error(this);
+            return;
+        }
+
+        fetchPhoto(randomGenerator()->bounded(m_photos.size()));
+    });
 }
 
 K_PLUGIN_CLASS_WITH_JSON(FlickrProvider, "flickrprovider.json")
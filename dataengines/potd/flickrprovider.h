@@ -26,9 +26,7 @@
 // Qt
 #include <QImage>
 #include <QDate>
-#include <QXmlStreamReader>
-
-class KJob;
+#include <QVector>
 
 /**
 * This class grabs a random image from the flickr
@@ -54,27 +52,28 @@ class FlickrProvider : public PotdProvider
          */
         ~FlickrProvider() override;
 
-        /**
-         * Returns the requested image.
-         *
-         * Note: This method returns only a valid image after the
-         *       finished() signal has been emitted.
-         */
-        QImage image() const override;
-
     private:
-        void pageRequestFinished(KJob *job);
-        void imageRequestFinished(KJob *job);
+        void requestList();
+        bool readList();
+        void writeList() const;
+        void pageRequestFinished(const QByteArray &data);
+        void listReady();
+        void fetchPhoto(int index);
 
     private:
-        QDate mActualDate;
-        QImage mImage;
+        struct Photo {
+            QByteArray id;
+            QByteArray url;
+            // small variant of the photo, if any
+            QByteArray previewUrl;
+        };
 
-        QXmlStreamReader xml;
+        QDate mActualDate;
 
         int mFailureNumber = 0;
+        int mImageFailureNumber = 0;
 
-        QStringList m_photoList;
+        QVector<Photo> m_photos;
 };
 
 #endif
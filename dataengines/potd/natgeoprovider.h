@@ -25,9 +25,6 @@
 #include "potdprovider.h"
 // Qt
 #include <QImage>
-#include <QRegularExpression>
-
-class KJob;
 
 /**
  * This class provides the image for APOD 
@@ -55,23 +52,6 @@ class NatGeoProvider : public PotdProvider
          * Destroys the APOD provider.
          */
         ~NatGeoProvider() override;
-
-        /**
-         * Returns the requested image.
-         *
-         * Note: This method returns only a valid image after the
-         *       finished() signal has been emitted.
-         */
-        QImage image() const override;
-
-    private:
-        void pageRequestFinished(KJob *job);
-        void imageRequestFinished(KJob *job);
-
-    private:
-        QImage mImage;
-
-        QRegularExpression re;
 };
 
 #endif
@@ -26,8 +26,6 @@
 // Qt
 #include <QImage>
 
-class KJob;
-
 /**
  * This class provides the image for NOAA Environmental Visualization Laboratory
  * Image Of the Day
@@ -50,21 +48,6 @@ class NOAAProvider : public PotdProvider
          * Destroys the NOAA provider.
          */
         ~NOAAProvider() override;
-
-        /**
-         * Returns the requested image.
-         *
-         * Note: This method returns only a valid image after the
-         *       finished() signal has been emitted.
-         */
-        QImage image() const override;
-
-    private:
-        void pageRequestFinished(KJob *job);
-        void imageRequestFinished(KJob *job);
-
-   private:
-        QImage mImage;
 };
 
 #endif
@@ -0,0 +1,109 @@
+/*
+ *   Copyright (C) 2020 by the Plasma Addons authors
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details
+ *
+ *   You should have received a copy of the GNU Library General Public
+ *   License along with this program; if not, write to the
+ *   Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "pluginindex.h"
+#include "debug.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLibrary>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include <KPluginLoader>
+
+namespace {
+// all provider libraries with their modification times, which is enough to tell
+// whether the index is still valid without opening any of them
+QJsonObject pluginFiles()
+{
+    QJsonObject files;
+    const QStringList libraryPaths = QCoreApplication::libraryPaths();
+    for ( const QString &libraryPath : libraryPaths ) {
+        const QDir dir( libraryPath + QLatin1String("/potd") );
+        const QFileInfoList entries = dir.entryInfoList( QDir::Files );
+        for ( const QFileInfo &entry : entries ) {
+            if ( QLibrary::isLibrary( entry.fileName() ) ) {
+                files.insert( entry.absoluteFilePath(), entry.lastModified().toMSecsSinceEpoch() );
+            }
+        }
+    }
+    return files;
+}
+}
+
+QString PluginIndex::defaultPath()
+{
+    const QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    QDir().mkpath(cacheDir);
+    return cacheDir + QLatin1String("/plasma_engine_potd_plugins.json");
+}
+
+QVector<KPluginMetaData> PluginIndex::providers( const QString &indexPath )
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    const QJsonObject files = pluginFiles();
+
+    QFile indexFile( indexPath );
+    if ( indexFile.open( QIODevice::ReadOnly ) ) {
+        const QJsonObject index = QJsonDocument::fromJson( indexFile.readAll() ).object();
+        if ( index.value(QLatin1String("files")).toObject() == files ) {
+            QVector<KPluginMetaData> plugins;
+            const QJsonArray entries = index.value(QLatin1String("plugins")).toArray();
+            for ( const QJsonValue &entry : entries ) {
+                const QJsonObject object = entry.toObject();
+                plugins << KPluginMetaData( object.value(QLatin1String("metadata")).toObject(),
+                                            object.value(QLatin1String("file")).toString() );
+            }
+            qCDebug(POTD_DEBUG) << "read" << plugins.count() << "providers from the index in" << timer.elapsed() << "ms";
+            return plugins;
+        }
+    }
+
+    const QVector<KPluginMetaData> plugins = KPluginLoader::findPlugins(QStringLiteral("potd"), [](const KPluginMetaData & md) {
+        return md.serviceTypes().contains(QStringLiteral("PlasmaPoTD/Plugin"));
+    });
+
+    QJsonArray entries;
+    for ( const auto &metadata : plugins ) {
+        entries.append( QJsonObject {
+            { QStringLiteral("file"), metadata.fileName() },
+            { QStringLiteral("metadata"), metadata.rawData() }
+        });
+    }
+    QSaveFile saveFile( indexPath );
+    if ( saveFile.open( QIODevice::WriteOnly ) ) {
+        saveFile.write( QJsonDocument( QJsonObject {
+            { QStringLiteral("files"), files },
+            { QStringLiteral("plugins"), entries }
+        }).toJson( QJsonDocument::Compact ) );
+        saveFile.commit();
+    }
+    qCDebug(POTD_DEBUG) << "scanned" << plugins.count() << "providers in" << timer.elapsed() << "ms";
+
+    return plugins;
+}
@@ -0,0 +1,49 @@
+/*
+ *   Copyright (C) 2020 by the Plasma Addons authors
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details
+ *
+ *   You should have received a copy of the GNU Library General Public
+ *   License along with this program; if not, write to the
+ *   Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef PLUGININDEX_H
+#define PLUGININDEX_H
+
+#include <QString>
+#include <QVector>
+
+#include <KPluginMetaData>
+
+/**
+ * The metadata of all provider plugins, kept in a file in the cache so the
+ * engine does not have to open every provider library when it starts.
+ */
+class PluginIndex
+{
+    public:
+        /**
+         * Returns the metadata of the providers in the "potd" directories of
+         * the library paths. The index in @p indexPath is used as long as the
+         * same libraries with the same modification times are there, and
+         * rebuilt otherwise.
+         */
+        static QVector<KPluginMetaData> providers( const QString &indexPath = defaultPath() );
+
+        /**
+         * Returns the path of the index in the cache of the engine.
+         */
+        static QString defaultPath();
+};
+
+#endif
@@ -19,30 +19,97 @@
 
 #include "potd.h"
 
+#include <QCoreApplication>
 #include <QDate>
+#include <QDateTime>
 #include <QFile>
 #include <QFileInfo>
+#include <QGuiApplication>
+#include <QRandomGenerator>
 #include <QRegularExpression>
+#include <QScreen>
 #include <QTimer>
 #include <QThreadPool>
 #include <QDebug>
 
+#include <KConfigGroup>
+#include <KPluginFactory>
 #include <KPluginLoader>
+#include <KSharedConfig>
 #include <KPluginMetaData>
 #include <Plasma/DataContainer>
 
 #include "cachedprovider.h"
+#include "debug.h"
+#include "pluginindex.h"
 
 namespace {
 namespace DataKeys {
 inline QString image() { return QStringLiteral("Image"); }
 inline QString url()   { return QStringLiteral("Url"); }
+inline QString images() { return QStringLiteral("Images"); }
+}
+
+// "Backdrop:<identifier>" publishes a blurred version of the picture of <identifier>
+const QLatin1String backdropPrefix("Backdrop:");
+
+bool isBackdrop( const QString &source )
+{
+    return source.startsWith( backdropPrefix );
+}
+
+// large enough to look sensible when scaled up as a wallpaper,
+// small enough to be decoded in a few milliseconds
+const QSize previewSize(640, 640);
+
+// prefetching starts at a random point of this window before midnight,
+// so not every machine asks the provider at the same moment
+const int prefetchWindowStart = 60 * 60 * 1000;
+const int prefetchWindowEnd = 15 * 60 * 1000;
+
+bool isDaily( const QString &identifier )
+{
+    static const QRegularExpression re(QLatin1String(":\\d{4}-\\d{2}-\\d{2}"));
+    return identifier != QLatin1String("Providers") && !isBackdrop(identifier) && !re.match(identifier).hasMatch();
+}
+
+// the identifier under which the picture of a daily source for @p date is staged
+QString datedIdentifier( const QString &identifier, const QDate &date )
+{
+    return identifier + QLatin1Char(':') + date.toString(Qt::ISODate);
+}
+
+// the size which covers every screen, there is no point in publishing larger pictures
+QSize displaySize()
+{
+    if ( !qobject_cast<QGuiApplication *>( QCoreApplication::instance() ) ) {
+        return QSize();
+    }
+
+    QSize size;
+    const QList<QScreen *> screens = QGuiApplication::screens();
+    for ( const QScreen *screen : screens ) {
+        size = size.expandedTo( screen->size() * screen->devicePixelRatio() );
+    }
+    return size;
+}
+
+// days after which unused lists and backdrops are removed from the cache
+const int defaultCacheRetention = 30;
+
+qint64 msecsToMidnight()
+{
+    const QDateTime now = QDateTime::currentDateTime();
+    return now.msecsTo(QDateTime(now.date().addDays(1), QTime(0, 0)));
 }
 }
 
 PotdEngine::PotdEngine( QObject* parent, const QVariantList& args )
-    : Plasma::DataEngine( parent, args )
+    : Plasma::DataEngine( parent, args ),
+      m_images( new ImageQueue, &QObject::deleteLater )
 {
+    connect( m_images.data(), &ImageQueue::ready, this, &PotdEngine::publishImages, Qt::QueuedConnection );
+
     // set polling to every 5 minutes
     setMinimumPollingInterval(5 * 60 * 1000);
     m_checkDatesTimer = new QTimer( this );//change picture after 24 hours
@@ -53,10 +120,7 @@ PotdEngine::PotdEngine( QObject* parent, const QVariantList& args )
     m_checkDatesTimer->setInterval( 10 * 60 * 1000 ); // check every 10 minutes
     m_checkDatesTimer->start();
 
-    const QVector<KPluginMetaData> plugins = KPluginLoader::findPlugins(QStringLiteral("potd"), [](const KPluginMetaData & md) {
-        return md.serviceTypes().contains(QStringLiteral("PlasmaPoTD/Plugin"));
-    });
-
+    const QVector<KPluginMetaData> plugins = PluginIndex::providers();
     for (const auto &metadata : plugins) {
         QString provider = metadata.value(QLatin1String( "X-KDE-PlasmaPoTDProvider-Identifier" ));
         if (provider.isEmpty()) {
@@ -65,6 +129,27 @@ PotdEngine::PotdEngine( QObject* parent, const QVariantList& args )
         mFactories.insert(provider, metadata);
         setData( QLatin1String( "Providers" ), provider, metadata.name() );
     }
+
+    const KConfigGroup config(KSharedConfig::openConfig(QStringLiteral("plasma_engine_potdrc")), "General");
+    const int retention = config.readEntry("CacheRetentionDays", defaultCacheRetention);
+    if ( retention > 0 ) {
+        QThreadPool::globalInstance()->start( new PruneCacheThread( retention ) );
+    }
+
+    if ( config.readEntry("PrefetchBeforeRollover", false) ) {
+        // coarse timers may fire hours early or late for intervals this long
+        m_prefetchTimer = new QTimer( this );
+        m_prefetchTimer->setSingleShot( true );
+        m_prefetchTimer->setTimerType( Qt::PreciseTimer );
+        connect( m_prefetchTimer, &QTimer::timeout, this, &PotdEngine::prefetch );
+
+        m_rolloverTimer = new QTimer( this );
+        m_rolloverTimer->setSingleShot( true );
+        m_rolloverTimer->setTimerType( Qt::PreciseTimer );
+        connect( m_rolloverTimer, &QTimer::timeout, this, &PotdEngine::rollover );
+
+        schedulePrefetch();
+    }
 }
 
 PotdEngine::~PotdEngine()
@@ -73,6 +158,11 @@ PotdEngine::~PotdEngine()
 
 bool PotdEngine::updateSourceEvent( const QString &identifier )
 {
+    // follows the picture it belongs to
+    if ( isBackdrop( identifier ) ) {
+        return false;
+    }
+
     return updateSource( identifier, false );
 }
 
@@ -80,12 +170,8 @@ bool PotdEngine::updateSource( const QString &identifier, bool loadCachedAlways
 {
     // check whether it is cached already...
     if ( CachedProvider::isCached( identifier, loadCachedAlways ) ) {
-        QVariantList args;
-        args << QLatin1String( "String" ) << identifier;
-
-        CachedProvider *provider = new CachedProvider( identifier, this );
-        connect( provider, SIGNAL(finished(PotdProvider*)), this, SLOT(finished(PotdProvider*)) );
-        connect( provider, SIGNAL(error(PotdProvider*)), this, SLOT(error(PotdProvider*)) );
+        const QString path = PotdProvider::identifierToPath( identifier );
+        QThreadPool::globalInstance()->start( new LoadImageThread( m_images, ImageQueue::Cached, identifier, path, displaySize() ) );
 
         m_canDiscardCache = loadCachedAlways;
         if (!loadCachedAlways) {
@@ -93,15 +179,28 @@ bool PotdEngine::updateSource( const QString &identifier, bool loadCachedAlways
         }
     }
 
+    PotdProvider *provider = createProvider( identifier );
+    if (provider) {
+        connect( provider, SIGNAL(finished(PotdProvider*)), this, SLOT(finished(PotdProvider*)) );
+        connect( provider, SIGNAL(previewFinished(PotdProvider*)), this, SLOT(previewFinished(PotdProvider*)) );
+        connect( provider, SIGNAL(error(PotdProvider*)), this, SLOT(error(PotdProvider*)) );
+        return true;
+    }
+
+    return false;
+}
+
+PotdProvider *PotdEngine::createProvider( const QString &identifier )
+{
     const QStringList parts = identifier.split( QLatin1Char( ':' ), QString::SkipEmptyParts );
     if (parts.empty()) {
         qDebug() << "invalid identifier";
-        return false;
+        return nullptr;
     }
     const QString providerName = parts[ 0 ];
     if ( !mFactories.contains( providerName ) ) {
         qDebug() << "invalid provider: " << parts[ 0 ];
-        return false;
+        return nullptr;
     }
     
     QVariantList args;
@@ -110,83 +209,200 @@ bool PotdEngine::updateSource( const QString &identifier, bool loadCachedAlways
         args << parts[i];
     }
 
-    auto factory = KPluginLoader(mFactories[ providerName ].fileName()).factory();
-    PotdProvider *provider = nullptr;
-    if (factory) {
-        provider = factory->create<PotdProvider>(this, args);
-    }
-    if (provider) {
-        connect( provider, SIGNAL(finished(PotdProvider*)), this, SLOT(finished(PotdProvider*)) );
-        connect( provider, SIGNAL(error(PotdProvider*)), this, SLOT(error(PotdProvider*)) );
-        return true;
+    KPluginFactory *factory = m_loadedFactories.value( providerName );
+    if (!factory) {
+        factory = KPluginLoader(mFactories[ providerName ].fileName()).factory();
+        if (!factory) {
+            return nullptr;
+        }
+        m_loadedFactories.insert( providerName, factory );
     }
-
-    return false;
+    return factory->create<PotdProvider>(this, args);
 }
 
 bool PotdEngine::sourceRequestEvent( const QString &identifier )
 {
+    if ( isBackdrop( identifier ) ) {
+        setData(identifier, DataKeys::image(), QImage());
+        const QString source = identifier.mid( backdropPrefix.size() );
+        if ( hasFullImage( source ) ) {
+            const Plasma::DataEngine::Data data = containerForSource( source )->data();
+            createBackdrop( source, data.value( DataKeys::url() ).toString(), data.value( DataKeys::image() ).value<QImage>() );
+        }
+        return true;
+    }
+
+    m_requestTimings[identifier].timer.start();
+
     if ( updateSource( identifier, true ) ) {
         setData(identifier, DataKeys::image(), QImage());
+        if ( !CachedProvider::isCached( identifier, true ) ) {
+            loadPreview( identifier );
+        }
         return true;
     }
 
+    m_requestTimings.remove(identifier);
     return false;
 }
 
-void PotdEngine::finished( PotdProvider *provider )
+void PotdEngine::loadPreview( const QString &identifier )
 {
-    if ( m_canDiscardCache && qobject_cast<CachedProvider *>( provider ) ) {
-        Plasma::DataContainer *source = containerForSource( provider->identifier() );
-        if ( source && !source->data().value(DataKeys::image()).value<QImage>().isNull() ) {
-            provider->deleteLater();
-            return;
+    const QString path = CachedProvider::previewPath( identifier );
+    if ( path.isEmpty() ) {
+        return;
+    }
+
+    QThreadPool::globalInstance()->start( new LoadImageThread( m_images, ImageQueue::Preview, identifier, path, previewSize ) );
+}
+
+bool PotdEngine::hasFullImage( const QString &source ) const
+{
+    Plasma::DataContainer *container = containerForSource( source );
+    return container && !m_previewSources.contains( source )
+        && !container->data().value(DataKeys::image()).value<QImage>().isNull();
+}
+
+void PotdEngine::createBackdrop( const QString &source, const QString &path, const QImage &img )
+{
+    // only done for the consumers which asked for it
+    const QString backdrop = backdropPrefix + source;
+    if ( img.isNull() || !containerForSource( backdrop ) ) {
+        return;
+    }
+
+    QThreadPool::globalInstance()->start( new BackdropThread( m_images, backdrop, path, img ) );
+}
+
+void PotdEngine::setPreview( const QString &source, const QImage &img )
+{
+    // never replace the full picture with a preview
+    if ( img.isNull() || !containerForSource( source ) || hasFullImage( source ) ) {
+        return;
+    }
+
+    m_previewSources.insert(source);
+    setData(source, DataKeys::image(), img);
+
+    auto it = m_requestTimings.find(source);
+    if ( it != m_requestTimings.end() && !it->hasFirstPixel ) {
+        it->hasFirstPixel = true;
+        qCDebug(POTD_DEBUG) << source << "time to first pixel:" << it->timer.elapsed() << "ms";
+    }
+}
+
+void PotdEngine::setImage( const QString &source, const QString &path, const QImage &img )
+{
+    m_previewSources.remove(source);
+    setData(source, DataKeys::image(), img);
+    setData(source, DataKeys::url(), path);
+    createBackdrop(source, path, img);
+    // consumers step through the other pictures of a batch themselves
+    const QStringList batchPaths = CachedProvider::batchPaths(source);
+    if ( !batchPaths.isEmpty() ) {
+        setData(source, DataKeys::images(), batchPaths);
+    }
+
+    auto it = m_requestTimings.find(source);
+    if ( it != m_requestTimings.end() && !img.isNull() ) {
+        const qint64 elapsed = it->timer.elapsed();
+        if ( !it->hasFirstPixel ) {
+            qCDebug(POTD_DEBUG) << source << "time to first pixel:" << elapsed << "ms";
         }
+        qCDebug(POTD_DEBUG) << source << "time to full image:" << elapsed << "ms";
+        m_requestTimings.erase(it);
     }
+}
 
+void PotdEngine::previewFinished( PotdProvider *provider )
+{
+    m_images->push( ImageQueue::Preview, provider->identifier(), QString(), provider->previewImage() );
+}
+
+void PotdEngine::finished( PotdProvider *provider )
+{
     QImage img(provider->image());
-    // store in cache if it's not the response of a CachedProvider
-    if ( qobject_cast<CachedProvider*>( provider ) == nullptr && !img.isNull() ) {
-        SaveImageThread *thread = new SaveImageThread( provider->identifier(), img );
-        connect(thread, SIGNAL(done(QString,QString,QImage)), this, SLOT(cachingFinished(QString,QString,QImage)));
-        QThreadPool::globalInstance()->start(thread);
+    // the image has been downloaded straight into the cache
+    if ( !provider->localPath().isEmpty() ) {
+        QThreadPool::globalInstance()->start( new ScaleImageThread( m_images, ImageQueue::Fetched, provider->identifier(), provider->localPath(), img, displaySize() ) );
+    } else if ( !img.isNull() ) {
+        QThreadPool::globalInstance()->start( new SaveImageThread( m_images, provider->identifier(), img, ImageQueue::Fetched, displaySize() ) );
     } else {
-        setData(provider->identifier(), DataKeys::image(), img);
-        setData(provider->identifier(), DataKeys::url(), CachedProvider::identifierToPath( provider->identifier()));
+        m_images->push( ImageQueue::Fetched, provider->identifier(), PotdProvider::identifierToPath( provider->identifier() ), img );
     }
 
     provider->deleteLater();
 }
 
-void PotdEngine::cachingFinished( const QString &source, const QString &path, const QImage &img )
+void PotdEngine::publishImages()
 {
-    setData(source, DataKeys::image(), img);
-    setData(source, DataKeys::url(), path);
+    // everything which arrived since the last event loop turn
+    const QVector<ImageQueue::Entry> entries = m_images->takeAll();
+    for (const ImageQueue::Entry &entry : entries) {
+        switch (entry.kind) {
+        case ImageQueue::Cached:
+            // a fresh picture may have been fetched while the cache was read
+            if ( m_canDiscardCache && hasFullImage( entry.source ) ) {
+                break;
+            }
+            setImage( entry.source, entry.path, entry.image );
+            break;
+        case ImageQueue::Fetched:
+            setImage( entry.source, entry.path, entry.image );
+            break;
+        case ImageQueue::Preview:
+            setPreview( entry.source, entry.image );
+            break;
+        case ImageQueue::Fallback:
+            if ( !entry.image.isNull() && !hasFullImage( entry.source ) ) {
+                setImage( entry.source, entry.path, entry.image );
+            }
+            break;
+        case ImageQueue::Backdrop:
+            if ( containerForSource( entry.source ) ) {
+                setData( entry.source, DataKeys::image(), entry.image );
+            }
+            break;
+        case ImageQueue::Prefetched:
+            // staged in the cache until the day changes
+            break;
+        }
+    }
 }
 
 void PotdEngine::error( PotdProvider *provider )
 {
+    const QString source = provider->identifier();
+
+    m_requestTimings.remove( source );
     provider->disconnect(this);
     provider->deleteLater();
+
+    // fall back to the cached picture of the previous day rather than showing nothing
+    if ( !containerForSource( source ) || hasFullImage( source ) ) {
+        return;
+    }
+
+    const QString path = CachedProvider::previewPath( source );
+    if ( path.isEmpty() ) {
+        return;
+    }
+
+    QThreadPool::globalInstance()->start( new LoadImageThread( m_images, ImageQueue::Fallback, source, path, displaySize() ) );
 }
 
 void PotdEngine::checkDayChanged()
 {
     SourceDict dict = containerDict();
     QHashIterator<QString, Plasma::DataContainer*> it( dict );
-    QRegularExpression re(QLatin1String(":\\d{4}-\\d{2}-\\d{2}"));
 
     while ( it.hasNext() ) {
         it.next();
 
-        if (it.key() == QLatin1String("Providers")) {
-            continue;
-        }
-
         // Check if the identifier contains ISO date string, like 2019-01-09.
         // If so, don't update the picture. Otherwise, update the picture.
-        if ( !re.match(it.key()).hasMatch() ) {
-            const QString path = CachedProvider::identifierToPath( it.key() );
+        if ( isDaily( it.key() ) ) {
+            const QString path = PotdProvider::identifierToPath( it.key() );
             if ( !QFile::exists(path) ) {
                 updateSourceEvent( it.key() );
             } else {
@@ -199,6 +415,98 @@ void PotdEngine::checkDayChanged()
     }
 }
 
+void PotdEngine::schedulePrefetch()
+{
+    const qint64 untilMidnight = msecsToMidnight();
+    const qint64 untilPrefetch = untilMidnight - prefetchWindowStart
+        + QRandomGenerator::global()->bounded(prefetchWindowStart - prefetchWindowEnd);
+
+    // started late in the evening, too late to be of any use today
+    if ( untilPrefetch > 0 ) {
+        m_prefetchTimer->start( untilPrefetch );
+    }
+    m_rolloverTimer->start( untilMidnight );
+}
+
+void PotdEngine::prefetch()
+{
+    const QDate tomorrow = QDate::currentDate().addDays(1);
+
+    const QStringList sources = containerDict().keys();
+    for ( const QString &source : sources ) {
+        // only single pictures are staged, the day change swaps one file
+        if ( !isDaily( source ) || source.split( QLatin1Char(':') ).contains( QLatin1String("batch") ) ) {
+            continue;
+        }
+
+        const KPluginMetaData metadata = mFactories.value( source.section( QLatin1Char(':'), 0, 0 ) );
+        if ( !metadata.rawData().value(QLatin1String("X-KDE-PlasmaPoTDProvider-SupportsPrefetch")).toBool() ) {
+            continue;
+        }
+
+        const QString staged = datedIdentifier( source, tomorrow );
+        if ( CachedProvider::isCached( staged, true ) ) {
+            continue;
+        }
+
+        PotdProvider *provider = createProvider( staged );
+        if ( !provider ) {
+            continue;
+        }
+
+        qCDebug(POTD_DEBUG) << "prefetching" << staged;
+        // the picture only has to end up in the cache, nothing is published yet
+        connect( provider, &PotdProvider::finished, this, [this](PotdProvider *provider) {
+            if ( provider->localPath().isEmpty() && !provider->image().isNull() ) {
+                QThreadPool::globalInstance()->start( new SaveImageThread( m_images, provider->identifier(), provider->image(), ImageQueue::Prefetched ) );
+            }
+            provider->deleteLater();
+        });
+        connect( provider, &PotdProvider::error, provider, &QObject::deleteLater );
+    }
+}
+
+void PotdEngine::rollover()
+{
+    // fired a little before midnight after all, the staged pictures are for tomorrow
+    const qint64 untilMidnight = msecsToMidnight();
+    if ( untilMidnight < prefetchWindowEnd ) {
+        m_rolloverTimer->start( untilMidnight + 1000 );
+        return;
+    }
+
+    const QDate today = QDate::currentDate();
+
+    // move the staged pictures into place and publish them; the check
+    // below finds them fresh, and only looks at the other sources
+    const QStringList sources = containerDict().keys();
+    for ( const QString &source : sources ) {
+        if ( !isDaily( source ) ) {
+            continue;
+        }
+
+        const QString stagedPath = PotdProvider::identifierToPath( datedIdentifier( source, today ) );
+        if ( !QFile::exists( stagedPath ) ) {
+            continue;
+        }
+
+        const QString path = PotdProvider::identifierToPath( source );
+        QFile::remove( path );
+        QFile staged( stagedPath );
+        if ( !staged.rename( path ) ) {
+            continue;
+        }
+        if ( staged.open( QIODevice::ReadWrite ) ) {
+            staged.setFileTime( QDateTime::currentDateTime(), QFileDevice::FileModificationTime );
+            staged.close();
+        }
+        updateSourceEvent( source );
+    }
+
+    checkDayChanged();
+    schedulePrefetch();
+}
+
 K_EXPORT_PLASMA_DATAENGINE_WITH_JSON(potdengine, PotdEngine, "plasma-dataengine-potd.json")
 
 #include "potd.moc"
@@ -23,9 +23,17 @@
 #include <Plasma/DataEngine>
 #include <KPluginMetaData>
 
+#include <QElapsedTimer>
+#include <QHash>
+#include <QSet>
+#include <QSharedPointer>
+#include <QVector>
+
+class ImageQueue;
 class PotdProvider;
 
 class QTimer;
+class KPluginFactory;
 
 /**
  * This class provides the Pictures of The Day from various online websites.
@@ -36,6 +44,19 @@ class QTimer;
  *   apod:2007-07-19
  *   unsplash:12435322
  *
+ * Sources with "batch" as an argument, e.g. bing:batch, fetch a whole list of
+ * pictures at once; the paths of all cached pictures are published as "Images".
+ *
+ * "Backdrop:<identifier>" publishes a small, blurred version of the picture of
+ * <identifier>, to be scaled up behind it when it does not fill the screen.
+ *
+ * With PrefetchBeforeRollover=true in the [General] group of plasma_engine_potdrc,
+ * the pictures of tomorrow are fetched shortly before midnight for providers which
+ * support it, so the daily sources can switch to them right at the day change.
+ *
+ * Cached Flickr lists and backdrops which have not been written for
+ * CacheRetentionDays days (30 by default, 0 keeps them forever) are removed
+ * when the engine starts. Pictures are never removed.
  */
 class PotdEngine : public Plasma::DataEngine
 {
@@ -53,16 +74,42 @@ class PotdEngine : public Plasma::DataEngine
 
     private Q_SLOTS:
         void finished( PotdProvider* );
+        void previewFinished( PotdProvider* );
         void error( PotdProvider* );
         void checkDayChanged();
-        void cachingFinished( const QString &source, const QString &path, const QImage &img );
+        void publishImages();
+        void prefetch();
+        void rollover();
 
     private:
         bool updateSource( const QString &identifier, bool loadCachedAlways );
+        PotdProvider *createProvider( const QString &identifier );
+        void schedulePrefetch();
+        void loadPreview( const QString &identifier );
+        void setPreview( const QString &source, const QImage &img );
+        void setImage( const QString &source, const QString &path, const QImage &img );
+        void createBackdrop( const QString &source, const QString &path, const QImage &img );
+        bool hasFullImage( const QString &source ) const;
+
+        struct RequestTiming {
+            QElapsedTimer timer;
+            bool hasFirstPixel = false;
+        };
 
         QMap<QString, KPluginMetaData> mFactories;
+        // resolved on first use, the libraries stay loaded for the lifetime of the process
+        QHash<QString, KPluginFactory*> m_loadedFactories;
         QTimer *m_checkDatesTimer;
-        bool m_canDiscardCache;
+        // only used when prefetching pictures ahead of the day change is enabled
+        QTimer *m_prefetchTimer = nullptr;
+        QTimer *m_rolloverTimer = nullptr;
+        bool m_canDiscardCache = false;
+        // shared with the worker threads, which may outlive the engine
+        QSharedPointer<ImageQueue> m_images;
+        // sources which currently only show a preview of their picture
+        QSet<QString> m_previewSources;
+        // sources which have not received their full picture since being requested
+        QHash<QString, RequestTiming> m_requestTimings;
 };
 
 #endif
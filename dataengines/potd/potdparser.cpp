@@ -0,0 +1,437 @@
+/*
+ *   Copyright (C) 2020 by the Plasma Addons authors
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details
+ *
+ *   You should have received a copy of the GNU Library General Public
+ *   License along with this program; if not, write to the
+ *   Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "potdparser.h"
+
+namespace {
+
+/**
+ * Walks through a JSON document and only looks closer at the
+ * values on the way to a path; everything else is skipped.
+ */
+class JsonScanner
+{
+public:
+    typedef std::function<bool(const QByteArray &value)> Callback;
+
+    JsonScanner(const QByteArray &data, const QList<QByteArray> &path, const Callback &callback)
+        : m_pos(data.constData()),
+          m_end(data.constData() + data.size()),
+          m_path(path),
+          m_callback(callback)
+    {
+    }
+
+    void run()
+    {
+        value(0);
+    }
+
+private:
+    void skipSpace()
+    {
+        while (m_pos < m_end && (*m_pos == ' ' || *m_pos == '\n' || *m_pos == '\r' || *m_pos == '\t')) {
+            ++m_pos;
+        }
+    }
+
+    bool matches(int depth, const QByteArray &key) const
+    {
+        return m_path.at(depth) == key || m_path.at(depth) == "*";
+    }
+
+    // returns false once the scan is done, because of an error or the callback
+    bool value(int depth)
+    {
+        skipSpace();
+        if (m_pos >= m_end) {
+            return false;
+        }
+
+        if (depth == m_path.count()) {
+            const char *start = m_pos;
+            if (*m_pos == '"') {
+                QByteArray result;
+                return string(&result) && m_callback(result);
+            }
+            return skipValue() && m_callback(QByteArray(start, int(m_pos - start)));
+        }
+
+        if (*m_pos == '{') {
+            ++m_pos;
+            skipSpace();
+            if (m_pos < m_end && *m_pos == '}') {
+                ++m_pos;
+                return true;
+            }
+            while (m_pos < m_end) {
+                skipSpace();
+                QByteArray key;
+                if (!string(&key)) {
+                    return false;
+                }
+                skipSpace();
+                if (m_pos >= m_end || *m_pos++ != ':') {
+                    return false;
+                }
+                if (!(matches(depth, key) ? value(depth + 1) : skipValue())) {
+                    return false;
+                }
+                if (!next('}')) {
+                    return m_pos <= m_end && m_pos[-1] == '}';
+                }
+            }
+            return false;
+        }
+
+        if (*m_pos == '[') {
+            ++m_pos;
+            skipSpace();
+            if (m_pos < m_end && *m_pos == ']') {
+                ++m_pos;
+                return true;
+            }
+            for (int index = 0; m_pos < m_end; ++index) {
+                if (!(matches(depth, QByteArray::number(index)) ? value(depth + 1) : skipValue())) {
+                    return false;
+                }
+                if (!next(']')) {
+                    return m_pos <= m_end && m_pos[-1] == ']';
+                }
+            }
+            return false;
+        }
+
+        // a string or a literal where the path goes deeper
+        return skipValue();
+    }
+
+    // consumes the separator after a member or an element; false at the end
+    bool next(char close)
+    {
+        skipSpace();
+        if (m_pos < m_end && *m_pos == ',') {
+            ++m_pos;
+            return true;
+        }
+        if (m_pos < m_end && *m_pos == close) {
+            ++m_pos;
+        }
+        return false;
+    }
+
+    bool skipValue()
+    {
+        skipSpace();
+        if (m_pos >= m_end) {
+            return false;
+        }
+
+        if (*m_pos == '"') {
+            return string(nullptr);
+        }
+
+        if (*m_pos == '{' || *m_pos == '[') {
+            int level = 0;
+            while (m_pos < m_end) {
+                const char c = *m_pos;
+                if (c == '"') {
+                    if (!string(nullptr)) {
+                        return false;
+                    }
+                    continue;
+                }
+                ++m_pos;
+                if (c == '{' || c == '[') {
+                    ++level;
+                } else if ((c == '}' || c == ']') && --level == 0) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        while (m_pos < m_end && *m_pos != ',' && *m_pos != '}' && *m_pos != ']'
+               && *m_pos != ' ' && *m_pos != '\n' && *m_pos != '\r' && *m_pos != '\t') {
+            ++m_pos;
+        }
+        return true;
+    }
+
+    static int hexDigit(char c)
+    {
+        if (c >= '0' && c <= '9') {
+            return c - '0';
+        }
+        if (c >= 'a' && c <= 'f') {
+            return c - 'a' + 10;
+        }
+        if (c >= 'A' && c <= 'F') {
+            return c - 'A' + 10;
+        }
+        return -1;
+    }
+
+    bool codeUnit(uint *unit)
+    {
+        if (m_end - m_pos < 4) {
+            return false;
+        }
+        *unit = 0;
+        for (int i = 0; i < 4; ++i) {
+            const int digit = hexDigit(*m_pos++);
+            if (digit < 0) {
+                return false;
+            }
+            *unit = *unit << 4 | uint(digit);
+        }
+        return true;
+    }
+
+    static void appendUtf8(QByteArray *out, uint code)
+    {
+        if (code < 0x80) {
+            out->append(char(code));
+        } else if (code < 0x800) {
+            out->append(char(0xc0 | code >> 6));
+            out->append(char(0x80 | (code & 0x3f)));
+        } else if (code < 0x10000) {
+            out->append(char(0xe0 | code >> 12));
+            out->append(char(0x80 | ((code >> 6) & 0x3f)));
+            out->append(char(0x80 | (code & 0x3f)));
+        } else {
+            out->append(char(0xf0 | code >> 18));
+            out->append(char(0x80 | ((code >> 12) & 0x3f)));
+            out->append(char(0x80 | ((code >> 6) & 0x3f)));
+            out->append(char(0x80 | (code & 0x3f)));
+        }
+    }
+
+    // reads a string at m_pos, unescaped into @p out unless that is null
+    bool string(QByteArray *out)
+    {
+        if (m_pos >= m_end || *m_pos != '"') {
+            return false;
+        }
+        ++m_pos;
+
+        while (m_pos < m_end) {
+            // copy runs without escapes in one go
+            const char *run = m_pos;
+            while (m_pos < m_end && *m_pos != '"' && *m_pos != '\\') {
+                ++m_pos;
+            }
+            if (out) {
+                out->append(run, int(m_pos - run));
+            }
+            if (m_pos >= m_end) {
+                return false;
+            }
+            if (*m_pos++ == '"') {
+                return true;
+            }
+
+            if (m_pos >= m_end) {
+                return false;
+            }
+            const char escaped = *m_pos++;
+            if (!out) {
+                continue;
+            }
+            switch (escaped) {
+            case 'b': out->append('\b'); break;
+            case 'f': out->append('\f'); break;
+            case 'n': out->append('\n'); break;
+            case 'r': out->append('\r'); break;
+            case 't': out->append('\t'); break;
+            case 'u': {
+                uint code;
+                if (!codeUnit(&code)) {
+                    return false;
+                }
+                // a surrogate pair
+                if (code >= 0xd800 && code < 0xdc00 && m_end - m_pos >= 6 && m_pos[0] == '\\' && m_pos[1] == 'u') {
+                    m_pos += 2;
+                    uint low;
+                    if (!codeUnit(&low)) {
+                        return false;
+                    }
+                    code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+                }
+                appendUtf8(out, code);
+                break;
+            }
+            default:
+                // \" \\ \/
+                out->append(escaped);
+            }
+        }
+        return false;
+    }
+
+    const char *m_pos;
+    const char *const m_end;
+    const QList<QByteArray> m_path;
+    const Callback m_callback;
+};
+
+QList<QByteArray> splitPath(const QByteArray &path)
+{
+    return path.isEmpty() ? QList<QByteArray>() : path.split('/');
+}
+
+QByteArray resolveEntities(const QByteArray &value)
+{
+    if (!value.contains('&')) {
+        return value;
+    }
+
+    QByteArray result = value;
+    result.replace("&lt;", "<");
+    result.replace("&gt;", ">");
+    result.replace("&quot;", "\"");
+    result.replace("&apos;", "'");
+    // last, so "&amp;lt;" stays "&lt;"
+    result.replace("&amp;", "&");
+    return result;
+}
+
+bool isNameEnd(char c)
+{
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '/' || c == '>';
+}
+
+}
+
+namespace PotdParser
+{
+
+QByteArray jsonValue(const QByteArray &data, const QByteArray &path)
+{
+    QByteArray result;
+    JsonScanner(data, splitPath(path), [&result](const QByteArray &value) {
+        result = value;
+        // an empty string must not look like no match at all
+        if (result.isNull()) {
+            result = QByteArray("", 0);
+        }
+        return false;
+    }).run();
+    return result;
+}
+
+QList<QByteArray> jsonValues(const QByteArray &data, const QByteArray &path)
+{
+    QList<QByteArray> result;
+    JsonScanner(data, splitPath(path), [&result](const QByteArray &value) {
+        result << value;
+        return true;
+    }).run();
+    return result;
+}
+
+void forEachXmlElement(const QByteArray &data, const QByteArray &name,
+                       const std::function<bool(const XmlAttributes &attributes)> &callback)
+{
+    const char *const end = data.constData() + data.size();
+    int from = 0;
+    while (true) {
+        const int start = data.indexOf('<', from);
+        if (start < 0) {
+            return;
+        }
+        const char *pos = data.constData() + start + 1;
+
+        // nothing inside comments and CDATA sections counts
+        if (end - pos >= 3 && qstrncmp(pos, "!--", 3) == 0) {
+            const int close = data.indexOf("-->", start + 4);
+            if (close < 0) {
+                return;
+            }
+            from = close + 3;
+            continue;
+        }
+        if (end - pos >= 8 && qstrncmp(pos, "![CDATA[", 8) == 0) {
+            const int close = data.indexOf("]]>", start + 9);
+            if (close < 0) {
+                return;
+            }
+            from = close + 3;
+            continue;
+        }
+
+        from = start + 1;
+        if (end - pos <= name.size() || qstrncmp(pos, name.constData(), uint(name.size())) != 0
+            || !isNameEnd(pos[name.size()])) {
+            continue;
+        }
+        pos += name.size();
+
+        XmlAttributes attributes;
+        while (pos < end && *pos != '>' && *pos != '/') {
+            if (*pos == ' ' || *pos == '\n' || *pos == '\r' || *pos == '\t') {
+                ++pos;
+                continue;
+            }
+
+            const char *attributeName = pos;
+            while (pos < end && *pos != '=' && *pos != '>' && !isNameEnd(*pos)) {
+                ++pos;
+            }
+            const QByteArray key(attributeName, int(pos - attributeName));
+            while (pos < end && (*pos == ' ' || *pos == '=')) {
+                ++pos;
+            }
+            if (pos >= end || (*pos != '"' && *pos != '\'')) {
+                break;
+            }
+
+            const char quote = *pos++;
+            const char *value = pos;
+            while (pos < end && *pos != quote) {
+                ++pos;
+            }
+            attributes.insert(key, resolveEntities(QByteArray(value, int(pos - value))));
+            ++pos;
+        }
+
+        if (!callback(attributes)) {
+            return;
+        }
+        from = int(pos - data.constData());
+    }
+}
+
+QByteArray textBetween(const QByteArray &data, const QByteArray &before, const QByteArray &after)
+{
+    const int start = data.indexOf(before);
+    if (start < 0) {
+        return QByteArray();
+    }
+
+    const int from = start + before.size();
+    const int end = data.indexOf(after, from);
+    if (end < 0) {
+        return QByteArray();
+    }
+
+    return data.mid(from, end - from);
+}
+
+}
@@ -0,0 +1,74 @@
+/*
+ *   Copyright (C) 2020 by the Plasma Addons authors
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details
+ *
+ *   You should have received a copy of the GNU Library General Public
+ *   License along with this program; if not, write to the
+ *   Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef POTDPARSER_H
+#define POTDPARSER_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+
+#include <functional>
+
+#include "plasma_potd_export.h"
+
+/**
+ * Helpers to pick the few values a provider needs out of a fetched page.
+ *
+ * They work on the raw data, without converting it to a QString or
+ * building a document first, and stop as soon as they have found what
+ * they are looking for. Values are returned as UTF-8.
+ */
+namespace PotdParser
+{
+
+/**
+ * Returns the first value at @p path in the JSON document @p data, or a null
+ * QByteArray if there is none. The path lists object keys and array indices
+ * separated by slashes, e.g. "images/0/url". Strings are unescaped, other
+ * values are returned as they are written.
+ */
+PLASMA_POTD_EXPORT QByteArray jsonValue(const QByteArray &data, const QByteArray &path);
+
+/**
+ * Like jsonValue(), but returns all values at @p path, in which an
+ * element "*" stands for any key or index.
+ */
+PLASMA_POTD_EXPORT QList<QByteArray> jsonValues(const QByteArray &data, const QByteArray &path);
+
+typedef QHash<QByteArray, QByteArray> XmlAttributes;
+
+/**
+ * Calls @p callback with the attributes of every element named @p name in
+ * the XML document @p data, in document order, until it returns false.
+ * Entities in the attribute values are resolved.
+ */
+PLASMA_POTD_EXPORT void forEachXmlElement(const QByteArray &data, const QByteArray &name,
+                                          const std::function<bool(const XmlAttributes &attributes)> &callback);
+
+/**
+ * Returns what is between the first occurrence of @p before in @p data and
+ * the next occurrence of @p after, or a null QByteArray. Meant for HTML pages,
+ * which are rarely valid enough for anything else.
+ */
+PLASMA_POTD_EXPORT QByteArray textBetween(const QByteArray &data, const QByteArray &before, const QByteArray &after);
+
+}
+
+#endif
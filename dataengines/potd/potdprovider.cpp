@@ -18,22 +18,369 @@
  */
 
 #include "potdprovider.h"
+#include "potdprovider_debug.h"
 
 // Qt
+#include <QBuffer>
+#include <QCryptographicHash>
 #include <QDate>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QImage>
+#include <QImageReader>
+#include <QRandomGenerator>
+#include <QRunnable>
+#include <QSaveFile>
+#include <QSharedPointer>
+#include <QStandardPaths>
+#include <QThreadPool>
+#include <QTimer>
+#include <QUrl>
+#include <QVector>
+
+// KF
+#include <KIO/Job>
+
+#include <memory>
+
+namespace {
+// abort a transfer which has not received any data for that long
+const int pageStallTimeout = 15 * 1000;
+const int imageStallTimeout = 30 * 1000;
+const int maxAttempts = 3;
+// the delay before the first retry, doubled for every further attempt
+const int retryDelay = 1000;
+// the number of images of a batch request which are downloaded at the same time
+const int maxParallelTransfers = 4;
+// the number of bytes collected before the image format is looked at,
+// more than any of the formats Qt knows needs to tell itself apart
+const int imageHeaderSize = 64;
+
+bool isImageHeader(const QByteArray &header)
+{
+    QBuffer buffer;
+    buffer.setData(header);
+    buffer.open(QIODevice::ReadOnly);
+    return !QImageReader::imageFormat(&buffer).isEmpty();
+}
+
+// Transfers can be recorded into, and replayed from, a directory of fixtures,
+// which makes it possible to run and time the providers offline.
+// Replayed files are fetched through KIO as well, so the code path is the same.
+QString fixturePath(const QString &dir, const QUrl &url)
+{
+    return dir + QLatin1Char('/') + QString::fromLatin1(QCryptographicHash::hash(url.toEncoded(), QCryptographicHash::Sha1).toHex());
+}
+
+// the largest resident set size of the process so far, in kB
+qint64 peakResidentSize()
+{
+#ifdef Q_OS_LINUX
+    QFile status(QStringLiteral("/proc/self/status"));
+    if (status.open(QIODevice::ReadOnly)) {
+        const QList<QByteArray> lines = status.readAll().split('\n');
+        for (const QByteArray &line : lines) {
+            if (line.startsWith("VmHWM:")) {
+                return line.mid(6).trimmed().split(' ').value(0).toLongLong();
+            }
+        }
+    }
+#endif
+    return -1;
+}
+}
+
+/**
+ * Decodes a downloaded image from a memory map of the file,
+ * so its compressed data never has to be copied to the heap.
+ */
+class DecodeImageThread : public QObject, public QRunnable
+{
+    Q_OBJECT
+
+public:
+    explicit DecodeImageThread(const QString &filePath)
+        : m_filePath(filePath)
+    {
+    }
+
+    void run() override
+    {
+        QElapsedTimer timer;
+        timer.start();
+
+        QImage image;
+        QFile file(m_filePath);
+        if (file.open(QIODevice::ReadOnly)) {
+            uchar *data = file.map(0, file.size());
+            if (data) {
+                image = QImage::fromData(data, int(file.size()));
+                file.unmap(data);
+            } else {
+                image.load(&file, nullptr);
+            }
+        }
+
+        const qint64 time = timer.elapsed();
+        const qint64 peakSize = peakResidentSize();
+        qCDebug(POTDPROVIDER_DEBUG) << "decoding" << m_filePath << "took" << time << "ms, peak RSS:" << peakSize << "kB";
+        emit done(image, time, peakSize);
+    }
+
+Q_SIGNALS:
+    void done(const QImage &image, qint64 time, qint64 peakResidentSize);
+
+private:
+    QString m_filePath;
+};
 
 class PotdProviderPrivate
 {
 public:
+    typedef std::function<void(const QByteArray &data)> DataCallback;
+
+    explicit PotdProviderPrivate(PotdProvider *parent)
+        : q(parent),
+          replayDir(qEnvironmentVariable("PLASMA_POTD_REPLAY_DIR")),
+          recordDir(qEnvironmentVariable("PLASMA_POTD_RECORD_DIR")),
+          replayRandom(qEnvironmentVariableIsSet("PLASMA_POTD_SEED") ? quint32(qEnvironmentVariableIntValue("PLASMA_POTD_SEED")) : 1)
+    {
+    }
+
+    /**
+     * Returns the url to fetch instead of @p url, which is the
+     * matching fixture when replaying.
+     */
+    QUrl transferUrl(const QUrl &url) const;
+
+    /**
+     * Fetches @p url and calls @p done or @p failed. Transfers are
+     * killed when @p context is destroyed, so that is the way to
+     * cancel them.
+     */
+    void get(QObject *context, const QUrl &url, int stallTimeout, int attempts,
+             const DataCallback &done, const std::function<void()> &failed, int attempt = 0);
+
+    /**
+     * Like get(), but streams the data into a QSaveFile for @p path
+     * instead of keeping it in memory. @p done receives the completed,
+     * not yet committed file, which is a child of @p context.
+     */
+    void getToFile(QObject *context, const QUrl &url, const QString &path, int attempts,
+                   const std::function<void(QSaveFile *file)> &done, const std::function<void()> &failed, int attempt = 0);
+
+    /**
+     * Decodes the image at @p path in a thread, then emits finished() or error().
+     */
+    void decode(const QString &path);
+
+    PotdProvider *q;
     QString name;
     QDate date;
     QString identifier;
+    QImage image;
+    QImage previewImage;
+    QString localPath;
+    bool batch = false;
+    bool done = false;
+    PotdProvider::Timings timings;
+
+    const QString replayDir;
+    const QString recordDir;
+    QRandomGenerator replayRandom;
 };
 
+QUrl PotdProviderPrivate::transferUrl(const QUrl &url) const
+{
+    if (replayDir.isEmpty()) {
+        return url;
+    }
+
+    return QUrl::fromLocalFile(fixturePath(replayDir, url));
+}
+
+void PotdProviderPrivate::get(QObject *context, const QUrl &url, int stallTimeout, int attempts,
+                              const DataCallback &done, const std::function<void()> &failed, int attempt)
+{
+    KIO::StoredTransferJob *job = KIO::storedGet(transferUrl(url), KIO::NoReload, KIO::HideProgressInfo);
+
+    QTimer *stallTimer = new QTimer(job);
+    stallTimer->setSingleShot(true);
+    stallTimer->setInterval(stallTimeout);
+    QObject::connect(stallTimer, &QTimer::timeout, job, [job]() {
+        job->kill(KJob::EmitResult);
+    });
+    QObject::connect(job, &KIO::TransferJob::data, stallTimer, [stallTimer]() {
+        stallTimer->start();
+    });
+    stallTimer->start();
+
+    QObject::connect(context, &QObject::destroyed, job, [job]() {
+        job->kill(KJob::Quietly);
+    });
+
+    QObject::connect(job, &KJob::result, context, [=]() {
+        if (!job->error()) {
+            if (!recordDir.isEmpty()) {
+                QSaveFile fixture(fixturePath(recordDir, url));
+                if (fixture.open(QIODevice::WriteOnly)) {
+                    fixture.write(job->data());
+                    fixture.commit();
+                }
+            }
+            done(job->data());
+            return;
+        }
+
+        // there is no point in asking again for something which is not there
+        if (attempt + 1 < attempts && job->error() != KIO::ERR_DOES_NOT_EXIST) {
+            qCDebug(POTDPROVIDER_DEBUG) << "retrying" << url << "after error:" << job->errorString();
+            QTimer::singleShot(retryDelay << attempt, context, [=]() {
+                get(context, url, stallTimeout, attempts, done, failed, attempt + 1);
+            });
+            return;
+        }
+
+        qCDebug(POTDPROVIDER_DEBUG) << "fetching" << url << "failed:" << job->errorString();
+        failed();
+    });
+}
+
+void PotdProviderPrivate::getToFile(QObject *context, const QUrl &url, const QString &path, int attempts,
+                                    const std::function<void(QSaveFile *file)> &done, const std::function<void()> &failed, int attempt)
+{
+    QSaveFile *file = new QSaveFile(path, context);
+    if (!file->open(QIODevice::WriteOnly)) {
+        qCDebug(POTDPROVIDER_DEBUG) << "cannot write" << path << file->errorString();
+        delete file;
+        failed();
+        return;
+    }
+
+    QSaveFile *fixture = nullptr;
+    if (!recordDir.isEmpty()) {
+        fixture = new QSaveFile(fixturePath(recordDir, url), file);
+        fixture->open(QIODevice::WriteOnly);
+    }
+
+    KIO::TransferJob *job = KIO::get(transferUrl(url), KIO::NoReload, KIO::HideProgressInfo);
+
+    QTimer *stallTimer = new QTimer(job);
+    stallTimer->setSingleShot(true);
+    stallTimer->setInterval(imageStallTimeout);
+    QObject::connect(stallTimer, &QTimer::timeout, job, [job]() {
+        job->kill(KJob::EmitResult);
+    });
+    stallTimer->start();
+
+    auto write = [file, fixture](const QByteArray &data) {
+        if (fixture) {
+            fixture->write(data);
+        }
+        return file->write(data) == data.size();
+    };
+
+    // some websites answer with an html page instead of an error, which must
+    // never end up in the cache; the first chunks can be too small to tell,
+    // so they are kept until there is enough to look at
+    struct Header {
+        QByteArray data;
+        bool checked = false;
+        bool notAnImage = false;
+    };
+    QSharedPointer<Header> header(new Header);
+    // returns false if the header is not that of an image, or cannot be written
+    auto checkHeader = [header, write]() {
+        header->checked = true;
+        header->notAnImage = !isImageHeader(header->data);
+        const bool written = !header->notAnImage && write(header->data);
+        header->data.clear();
+        return written;
+    };
+
+    QObject::connect(job, &KIO::TransferJob::data, file, [job, stallTimer, header, write, checkHeader](KIO::Job *, const QByteArray &data) {
+        stallTimer->start();
+        if (data.isEmpty()) {
+            return;
+        }
+
+        if (header->checked) {
+            if (!write(data)) {
+                job->kill(KJob::EmitResult);
+            }
+            return;
+        }
+
+        header->data += data;
+        if (header->data.size() >= imageHeaderSize && !checkHeader()) {
+            job->kill(KJob::EmitResult);
+        }
+    });
+
+    QObject::connect(context, &QObject::destroyed, job, [job]() {
+        job->kill(KJob::Quietly);
+    });
+
+    QObject::connect(job, &KJob::result, context, [=]() {
+        // an image smaller than the header, or an empty answer
+        if (!job->error() && !header->checked) {
+            checkHeader();
+        }
+
+        if (!job->error() && !header->notAnImage && file->error() == QFileDevice::NoError) {
+            if (fixture) {
+                fixture->commit();
+            }
+            done(file);
+            return;
+        }
+
+        // discards everything written so far
+        delete file;
+
+        if (!header->notAnImage && attempt + 1 < attempts && job->error() != KIO::ERR_DOES_NOT_EXIST) {
+            qCDebug(POTDPROVIDER_DEBUG) << "retrying" << url << "after error:" << job->errorString();
+            QTimer::singleShot(retryDelay << attempt, context, [=]() {
+                getToFile(context, url, path, attempts, done, failed, attempt + 1);
+            });
+            return;
+        }
+
+        qCDebug(POTDPROVIDER_DEBUG) << "fetching" << url << "failed:" << (header->notAnImage ? QStringLiteral("not an image") : job->errorString());
+        failed();
+    });
+}
+
+void PotdProviderPrivate::decode(const QString &path)
+{
+    DecodeImageThread *thread = new DecodeImageThread(path);
+    QObject::connect(thread, &DecodeImageThread::done, q, [this, path](const QImage &decoded, qint64 time, qint64 peakResidentSize) {
+        timings.decode = time;
+        timings.peakResidentSize = peakResidentSize;
+        image = decoded;
+        if (image.isNull()) {
+            // a truncated or otherwise broken file must not stay in the cache
+            QFile::remove(path);
+            emit q->error(q);
+            return;
+        }
+
+        localPath = path;
+        emit q->finished(q);
+    });
+    QThreadPool::globalInstance()->start(thread);
+}
+
 PotdProvider::PotdProvider( QObject *parent, const QVariantList &args )
     : QObject( parent ),
-      d(new PotdProviderPrivate)
+      d(new PotdProviderPrivate(this))
 {
+    connect(this, &PotdProvider::finished, this, [this]() { d->done = true; });
+    connect(this, &PotdProvider::error, this, [this]() { d->done = true; });
+
     if ( args.count() > 0 ) {
         d->name = args[ 0 ].toString();
         
@@ -45,6 +392,8 @@ PotdProvider::PotdProvider( QObject *parent, const QVariantList &args )
                 QDate date = QDate::fromString(args[ i ].toString(), Qt::ISODate);
                 if (date.isValid()) {
                     d->date = date;
+                } else if (args[ i ].toString() == QLatin1String("batch")) {
+                    d->batch = true;
                 }
             }
         }
@@ -73,9 +422,274 @@ bool PotdProvider::isFixedDate() const
     return !d->date.isNull();
 }
 
+bool PotdProvider::isBatch() const
+{
+    return d->batch;
+}
+
 QString PotdProvider::identifier() const
 {
     return d->identifier;
 }
 
+QImage PotdProvider::image() const
+{
+    return d->image;
+}
+
+QString PotdProvider::localPath() const
+{
+    return d->localPath;
+}
+
+QString PotdProvider::identifierToPath( const QString &identifier )
+{
+    const QString dataDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QLatin1String("/plasma_engine_potd/");
+    QDir d;
+    d.mkpath(dataDir);
+    return dataDir + identifier;
+}
+
+PotdProvider::Timings PotdProvider::timings() const
+{
+    return d->timings;
+}
+
+QImage PotdProvider::previewImage() const
+{
+    return d->previewImage;
+}
+
+void PotdProvider::fetchPage( const QUrl &url, const PageParser &parser )
+{
+    fetch(url, [this, url, parser](const QByteArray &data) {
+        const QUrl imageUrl = parser(data);
+
+        if (!imageUrl.isValid()) {
+            qCDebug(POTDPROVIDER_DEBUG) << "no image found in" << url;
+            emit error(this);
+            return;
+        }
+
+        fetchImage(imageUrl);
+    });
+}
+
+void PotdProvider::fetch( const QUrl &url, const std::function<void(const QByteArray &data)> &callback )
+{
+    d->get(this, url, pageStallTimeout, maxAttempts, [this, url, callback](const QByteArray &data) {
+        QElapsedTimer timer;
+        timer.start();
+        callback(data);
+        d->timings.parse = timer.nsecsElapsed() / 1000;
+        qCDebug(POTDPROVIDER_DEBUG) << identifier() << "parsing" << url << "took" << d->timings.parse << "us";
+    }, [this]() {
+        emit error(this);
+    });
+}
+
+void PotdProvider::fetchImage( const QUrl &url, const std::function<void()> &failed )
+{
+    d->getToFile(this, url, identifierToPath(identifier()), maxAttempts, [this](QSaveFile *file) {
+        QElapsedTimer timer;
+        timer.start();
+        const bool committed = file->commit();
+        delete file;
+        d->timings.write = timer.elapsed();
+        qCDebug(POTDPROVIDER_DEBUG) << identifier() << "writing the cache took" << d->timings.write << "ms";
+        if (!committed) {
+            emit error(this);
+            return;
+        }
+
+        d->decode(identifierToPath(identifier()));
+    }, [this, failed]() {
+        if (failed) {
+            failed();
+            return;
+        }
+        emit error(this);
+    });
+}
+
+void PotdProvider::fetchImage( const QList<QUrl> &urls )
+{
+    if (urls.isEmpty()) {
+        emit error(this);
+        return;
+    }
+
+    if (urls.count() == 1) {
+        fetchImage(urls.first());
+        return;
+    }
+
+    struct Alternative {
+        bool pending = true;
+        QSaveFile *file = nullptr;
+    };
+    struct State {
+        QVector<Alternative> alternatives;
+        bool settled = false;
+    };
+    QSharedPointer<State> state(new State);
+    state->alternatives.resize(urls.count());
+    // destroying the context aborts the transfers which are no longer needed
+    QObject *context = new QObject(this);
+
+    // picks the most preferred image once everything preferred over it has failed
+    auto settle = [this, context, state]() {
+        if (state->settled) {
+            return;
+        }
+
+        for (const Alternative &alternative : qAsConst(state->alternatives)) {
+            if (alternative.pending) {
+                return;
+            }
+            if (alternative.file) {
+                state->settled = true;
+                // the other files are discarded together with the context
+                QElapsedTimer timer;
+                timer.start();
+                const bool committed = alternative.file->commit();
+                d->timings.write = timer.elapsed();
+                qCDebug(POTDPROVIDER_DEBUG) << identifier() << "writing the cache took" << d->timings.write << "ms";
+                context->deleteLater();
+                if (!committed) {
+                    emit error(this);
+                    return;
+                }
+                d->decode(identifierToPath(identifier()));
+                return;
+            }
+        }
+
+        state->settled = true;
+        context->deleteLater();
+        emit error(this);
+    };
+
+    const QString path = identifierToPath(identifier());
+    for (int i = 0; i < urls.count(); ++i) {
+        d->getToFile(context, urls.at(i), path, maxAttempts, [state, settle, i](QSaveFile *file) {
+            state->alternatives[i].pending = false;
+            state->alternatives[i].file = file;
+            settle();
+        }, [state, settle, i]() {
+            state->alternatives[i].pending = false;
+            settle();
+        });
+    }
+}
+
+void PotdProvider::fetchImages( const QList<QUrl> &urls )
+{
+    if (urls.isEmpty()) {
+        emit error(this);
+        return;
+    }
+
+    struct State {
+        QList<QUrl> urls;
+        QVector<bool> fetched;
+        int next = 0;
+        int running = 0;
+    };
+    QSharedPointer<State> state(new State);
+    state->urls = urls;
+    state->fetched.fill(false, urls.count());
+
+    const QString mainPath = identifierToPath(identifier());
+    auto entryPath = [this, mainPath](int index) {
+        return index == 0 ? mainPath : identifierToPath(identifier() + QLatin1Char(':') + QString::number(index));
+    };
+
+    auto complete = [this, state, mainPath, entryPath]() {
+        QStringList paths;
+        for (int i = 0; i < state->fetched.count(); ++i) {
+            if (state->fetched.at(i)) {
+                paths << entryPath(i);
+            }
+        }
+
+        if (paths.isEmpty()) {
+            emit error(this);
+            return;
+        }
+
+        // the first picture always lives at the cache file of the identifier,
+        // so loading a batch from the cache is no different from any other source
+        if (paths.first() != mainPath) {
+            QFile::remove(mainPath);
+            if (!QFile::rename(paths.first(), mainPath)) {
+                emit error(this);
+                return;
+            }
+            paths.first() = mainPath;
+        }
+
+        QSaveFile list(mainPath + QLatin1String(".list"));
+        if (list.open(QIODevice::WriteOnly)) {
+            for (const QString &path : qAsConst(paths)) {
+                list.write(QFile::encodeName(QFileInfo(path).fileName()) + '\n');
+            }
+            list.commit();
+        }
+        qCDebug(POTDPROVIDER_DEBUG) << identifier() << "fetched" << paths.count() << "of" << state->urls.count() << "images";
+
+        d->decode(mainPath);
+    };
+
+    // starts transfers until the limit is reached, every finished one starts the next;
+    // it is kept alive by the pending transfers only
+    auto startNext = std::make_shared<std::function<void()>>();
+    std::weak_ptr<std::function<void()>> weakStartNext = startNext;
+    *startNext = [this, state, entryPath, complete, weakStartNext]() {
+        const auto startNext = weakStartNext.lock();
+        while (state->running < maxParallelTransfers && state->next < state->urls.count()) {
+            const int index = state->next++;
+            ++state->running;
+            auto settle = [state, complete, startNext, index](bool fetched) {
+                state->fetched[index] = fetched;
+                --state->running;
+                if (state->running == 0 && state->next == state->urls.count()) {
+                    complete();
+                } else {
+                    (*startNext)();
+                }
+            };
+            d->getToFile(this, state->urls.at(index), entryPath(index), maxAttempts, [settle](QSaveFile *file) {
+                const bool committed = file->commit();
+                delete file;
+                settle(committed);
+            }, [settle]() {
+                settle(false);
+            });
+        }
+    };
+    (*startNext)();
+}
+
+void PotdProvider::requestPreview( const QUrl &url )
+{
+    // a single attempt only, the preview is worthless once the image is there
+    d->get(this, url, pageStallTimeout, 1, [this](const QByteArray &data) {
+        // the full image won the race, a preview would only cause flicker
+        if (d->done) {
+            return;
+        }
+
+        d->previewImage = QImage::fromData(data);
+        if (!d->previewImage.isNull()) {
+            emit previewFinished(this);
+        }
+    }, []() {});
+}
+
+QRandomGenerator *PotdProvider::randomGenerator() const
+{
+    return d->replayDir.isEmpty() ? QRandomGenerator::global() : &d->replayRandom;
+}
 
+#include "potdprovider.moc"
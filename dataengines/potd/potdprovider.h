@@ -23,10 +23,14 @@
 #include <QObject>
 #include <QVariantList>
 
+#include <functional>
+
 #include "plasma_potd_export.h"
 
 class QImage;
 class QDate;
+class QRandomGenerator;
+class QUrl;
 
 /**
  * This class is an interface for PoTD providers.
@@ -52,10 +56,54 @@ class PLASMA_POTD_EXPORT PotdProvider : public QObject
         /**
          * Returns the requested image.
          *
+         * The default implementation returns the image fetched by
+         * fetchPage() or fetchImage().
+         *
          * Note: This method returns only a valid image after the
          *       finished() signal has been emitted.
          */
-        virtual QImage image() const = 0;
+        virtual QImage image() const;
+
+        /**
+         * Returns the path of the file the requested image has been
+         * downloaded to by fetchImage(), or an empty string if it
+         * only exists in memory.
+         *
+         * Note: This method returns only a valid path after the
+         *       finished() signal has been emitted.
+         */
+        QString localPath() const;
+
+        /**
+         * Returns a low resolution preview of the requested image.
+         *
+         * Note: This method returns only a valid image after the
+         *       previewFinished() signal has been emitted.
+         */
+        QImage previewImage() const;
+
+        /**
+         * How long the stages of fetching the picture took, as logged with
+         * the kde.potdprovider category; -1 for stages which did not run.
+         */
+        struct Timings {
+            /// parsing the page, in microseconds
+            qint64 parse = -1;
+            /// committing the cache file, in milliseconds
+            qint64 write = -1;
+            /// decoding the image, in milliseconds
+            qint64 decode = -1;
+            /// the peak resident set size of the process after decoding, in kB
+            qint64 peakResidentSize = -1;
+        };
+
+        /**
+         * Returns the timings of the stages of the request.
+         *
+         * Note: This method returns only complete timings after the
+         *       finished() signal has been emitted.
+         */
+        Timings timings() const;
 
         /**
          * Returns the identifier of the PoTD request (name + date).
@@ -77,6 +125,20 @@ class PLASMA_POTD_EXPORT PotdProvider : public QObject
          */
         bool isFixedDate() const;
 
+        /**
+         * @return if a whole list of pictures is requested instead of a single
+         * one, which is the case when "batch" is one of the arguments, e.g. bing:batch
+         *
+         * The pictures are stored next to the cache file of the first one, and
+         * listed in a file with the same name and a ".list" suffix.
+         */
+        bool isBatch() const;
+
+        /**
+         * Returns the path of the cache file for the picture with the given @p identifier.
+         */
+        static QString identifierToPath( const QString &identifier );
+
     Q_SIGNALS:
         /**
          * This signal is emitted whenever a request has been finished
@@ -93,6 +155,88 @@ class PLASMA_POTD_EXPORT PotdProvider : public QObject
          */
         void error( PotdProvider *provider );
 
+        /**
+         * This signal is emitted when a low resolution preview of the
+         * requested image is available. It is always emitted before
+         * finished(), and never after it.
+         *
+         * @param provider The provider which emitted the signal.
+         */
+        void previewFinished( PotdProvider *provider );
+
+    protected:
+        /**
+         * Extracts the url of the image from the data of a fetched page.
+         * Returns an invalid url if the page does not contain one.
+         */
+        typedef std::function<QUrl(const QByteArray &data)> PageParser;
+
+        /**
+         * Fetches the page at @p url, passes its data to @p parser and
+         * then fetches the image at the url returned by the parser.
+         *
+         * This is what most providers need: either finished() or error()
+         * is emitted at the end. Stalled transfers are aborted after a
+         * timeout and failed transfers are retried with exponential backoff.
+         */
+        void fetchPage( const QUrl &url, const PageParser &parser );
+
+        /**
+         * Fetches the data at @p url with the same timeout and retry
+         * handling as fetchPage() and passes it to @p callback.
+         * error() is emitted if all attempts fail.
+         *
+         * The helpers in potdparser.h get values out of the data
+         * without converting or copying all of it.
+         */
+        void fetch( const QUrl &url, const std::function<void(const QByteArray &data)> &callback );
+
+        /**
+         * Fetches the image at @p url, then emits finished() or error().
+         *
+         * The data is written straight to the cache file while it is
+         * downloaded, which only replaces the previous file once the
+         * transfer has completed.
+         *
+         * If @p failed is set, it is called instead of emitting error()
+         * when the image cannot be downloaded, so another one can be tried.
+         */
+        void fetchImage( const QUrl &url, const std::function<void()> &failed = std::function<void()>() );
+
+        /**
+         * Fetches alternative resolutions of the image in parallel.
+         *
+         * @p urls is ordered from the most to the least preferred image;
+         * the most preferred image which could be fetched is used and the
+         * remaining transfers are aborted as soon as it is known.
+         */
+        void fetchImage( const QList<QUrl> &urls );
+
+        /**
+         * Fetches all images at @p urls for a batch request, a few at a time,
+         * then emits finished() once all transfers are done, with the first
+         * image which could be fetched as image(). error() is only emitted
+         * if none of them could be fetched.
+         *
+         * @see isBatch()
+         */
+        void fetchImages( const QList<QUrl> &urls );
+
+        /**
+         * Fetches a low resolution variant of the image from @p url,
+         * e.g. a thumbnail offered by the website, so it can be shown
+         * while the full image is still being downloaded.
+         */
+        void requestPreview( const QUrl &url );
+
+        /**
+         * Returns the generator to use for random choices, e.g. which of
+         * several pictures to show. While transfers are replayed it is
+         * seeded with PLASMA_POTD_SEED, or 1 if that is not set, so every
+         * run makes the same choices.
+         */
+        QRandomGenerator *randomGenerator() const;
+
     private:
         const QScopedPointer<class PotdProviderPrivate> d;
 };
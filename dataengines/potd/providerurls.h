@@ -0,0 +1,107 @@
+/*
+ *   Copyright (C) 2020 by the Plasma Addons authors
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details
+ *
+ *   You should have received a copy of the GNU Library General Public
+ *   License along with this program; if not, write to the
+ *   Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef PROVIDERURLS_H
+#define PROVIDERURLS_H
+
+#include <QDate>
+#include <QString>
+#include <QUrl>
+#include <QUrlQuery>
+
+/**
+ * The urls of the pages the providers fetch first, shared with the tests,
+ * which replay recorded copies of them.
+ */
+namespace ProviderUrls
+{
+
+/// the page of the picture of @p date, or of the current one if @p date is null
+inline QUrl apod(const QDate &date)
+{
+    return QUrl(date.isNull()
+                ? QStringLiteral("http://antwrp.gsfc.nasa.gov/apod/")
+                : QLatin1String("http://antwrp.gsfc.nasa.gov/apod/ap") + date.toString(QStringLiteral("yyMMdd")) + QLatin1String(".html"));
+}
+
+/// the archive of the last @p count pictures, the current one first
+inline QUrl bingArchive(int count)
+{
+    return QUrl(QStringLiteral("https://www.bing.com/HPImageArchive.aspx?format=js&idx=0&n=%1").arg(count));
+}
+
+inline QUrl epod()
+{
+    return QUrl(QStringLiteral("https://epod.usra.edu/blog/"));
+}
+
+/// the interestingness list of @p date
+inline QUrl flickrList(const QDate &date)
+{
+    QUrl url(QStringLiteral("https://api.flickr.com/services/rest/"));
+    QUrlQuery urlQuery(url);
+    urlQuery.addQueryItem(QStringLiteral("api_key"), QStringLiteral("11829a470557ad8e10b02e80afacb3af"));
+    urlQuery.addQueryItem(QStringLiteral("method"), QStringLiteral("flickr.interestingness.getList"));
+    urlQuery.addQueryItem(QStringLiteral("date"), date.toString(Qt::ISODate));
+    // url_o might be either too small or too large.
+    // url_m is only used as a preview while the full picture is downloaded.
+    urlQuery.addQueryItem(QStringLiteral("extras"), QStringLiteral("url_k,url_h,url_o,url_m"));
+    url.setQuery(urlQuery);
+    return url;
+}
+
+inline QUrl natGeo()
+{
+    return QUrl(QStringLiteral("https://www.nationalgeographic.com/photography/photo-of-the-day/"));
+}
+
+inline QUrl noaa()
+{
+    return QUrl(QStringLiteral("https://www.nesdis.noaa.gov/content/imagery-and-data"));
+}
+
+/// the picture of the day of the collection @p collectionId, there is no page
+inline QUrl unsplashDaily(const QString &collectionId)
+{
+    return QUrl(QStringLiteral("https://source.unsplash.com/collection/%1/3840x2160/daily").arg(collectionId));
+}
+
+/// a random picture of the collection @p collectionId, another one for every @p signature
+inline QUrl unsplashRandom(const QString &collectionId, qint64 signature)
+{
+    return QUrl(QStringLiteral("https://source.unsplash.com/collection/%1/3840x2160/?sig=%2").arg(collectionId).arg(signature));
+}
+
+/// the images of the Potd template of Wikimedia Commons, the picture first
+inline QUrl wikimedia()
+{
+    QUrl url(QStringLiteral("https://commons.wikimedia.org/w/api.php"));
+    QUrlQuery urlQuery(url);
+    urlQuery.addQueryItem(QStringLiteral("action"), QStringLiteral("parse"));
+    urlQuery.addQueryItem(QStringLiteral("text"), QStringLiteral("{{Potd}}"));
+    urlQuery.addQueryItem(QStringLiteral("contentmodel"), QStringLiteral("wikitext"));
+    urlQuery.addQueryItem(QStringLiteral("prop"), QStringLiteral("images"));
+    urlQuery.addQueryItem(QStringLiteral("format"), QStringLiteral("json"));
+    url.setQuery(urlQuery);
+    return url;
+}
+
+}
+
+#endif
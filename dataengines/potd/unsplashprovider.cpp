@@ -18,12 +18,18 @@
  */
 
 #include "unsplashprovider.h"
+#include "providerurls.h"
 
+#include <QDate>
 #include <QDebug>
+#include <QUrl>
 #include <QRegularExpression>
 
 #include <KPluginFactory>
-#include <KIO/Job>
+
+namespace {
+const int batchSize = 8;
+}
 
 UnsplashProvider::UnsplashProvider(QObject* parent, const QVariantList& args)
     : PotdProvider(parent, args)
@@ -36,30 +42,25 @@ UnsplashProvider::UnsplashProvider(QObject* parent, const QVariantList& args)
             collectionId = str;
         }
     }
-    const QUrl url(QStringLiteral("https://source.unsplash.com/collection/%1/3840x2160/daily").arg(collectionId));
-
-    KIO::StoredTransferJob* job = KIO::storedGet(url, KIO::NoReload, KIO::HideProgressInfo);
-    connect(job, &KIO::StoredTransferJob::finished, this, &UnsplashProvider::imageRequestFinished);
-}
+    if (isBatch()) {
+        // every signature picks another random picture of the collection,
+        // so no list has to be requested first; they change with the date,
+        // or caches along the way would answer with the pictures of yesterday
+        const qint64 firstSignature = date().toJulianDay() * batchSize;
+        QList<QUrl> urls;
+        for (int i = 0; i < batchSize; i++) {
+            urls << ProviderUrls::unsplashRandom(collectionId, firstSignature + i);
+        }
+        fetchImages(urls);
+        return;
+    }
 
-UnsplashProvider::~UnsplashProvider() = default;
+    const QUrl url = ProviderUrls::unsplashDaily(collectionId);
 
-QImage UnsplashProvider::image() const
-{
-    return mImage;
+    fetchImage(url);
 }
 
-void UnsplashProvider::imageRequestFinished(KJob* _job)
-{
-    KIO::StoredTransferJob* job = static_cast<KIO::StoredTransferJob*>(_job);
-    if (job->error()) {
-        emit error(this);
-        return;
-    }
-    QByteArray data = job->data();
-    mImage = QImage::fromData(data);
-    emit finished(this);
-}
+UnsplashProvider::~UnsplashProvider() = default;
 
 K_PLUGIN_CLASS_WITH_JSON(UnsplashProvider, "unsplashprovider.json")
 
@@ -20,78 +20,32 @@
  */
 
 #include "wcpotdprovider.h"
+#include "potdparser.h"
+#include "providerurls.h"
 
-#include <QUrlQuery>
-#include <QJsonDocument>
-#include <QJsonArray>
 #include <QImage>
 #include <QDebug>
+#include <QUrl>
 
 #include <KPluginFactory>
-#include <KIO/Job>
 
 
 WcpotdProvider::WcpotdProvider(QObject *parent, const QVariantList &args)
     : PotdProvider(parent, args)
 {
-    QUrl url(QStringLiteral("https://commons.wikimedia.org/w/api.php"));
+    const QUrl url = ProviderUrls::wikimedia();
 
-    QUrlQuery urlQuery(url);
-    urlQuery.addQueryItem(QStringLiteral("action"), QStringLiteral("parse"));
-    urlQuery.addQueryItem(QStringLiteral("text"), QStringLiteral("{{Potd}}"));
-    urlQuery.addQueryItem(QStringLiteral("contentmodel"), QStringLiteral("wikitext"));
-    urlQuery.addQueryItem(QStringLiteral("prop"), QStringLiteral("images"));
-    urlQuery.addQueryItem(QStringLiteral("format"), QStringLiteral("json"));
-    url.setQuery(urlQuery);
-
-    KIO::StoredTransferJob *job = KIO::storedGet(url, KIO::NoReload, KIO::HideProgressInfo);
-    connect(job, &KIO::StoredTransferJob::finished, this, &WcpotdProvider::pageRequestFinished);
-}
-
-WcpotdProvider::~WcpotdProvider() = default;
-
-QImage WcpotdProvider::image() const
-{
-    return mImage;
-}
-
-void WcpotdProvider::pageRequestFinished(KJob *_job)
-{
-    KIO::StoredTransferJob *job = static_cast<KIO::StoredTransferJob *>( _job );
-    if ( job->error() ) {
-	emit error(this);
-	return;
-    }
-
-    auto jsonImageArray = QJsonDocument::fromJson(job->data())
-        .object().value(QLatin1String("parse"))
-        .toObject().value(QLatin1String("images"))
-        .toArray();
-
-    if (jsonImageArray.size() > 0) {
-        const QString imageFile = jsonImageArray.at(0).toString();
+    fetchPage(url, [](const QByteArray &data) {
+        const QByteArray imageFile = PotdParser::jsonValue(data, "parse/images/0");
         if (!imageFile.isEmpty()) {
-            const QUrl picUrl(QLatin1String("https://commons.wikimedia.org/wiki/Special:FilePath/") + imageFile);
-            KIO::StoredTransferJob *imageJob = KIO::storedGet( picUrl, KIO::NoReload, KIO::HideProgressInfo );
-            connect(imageJob, &KIO::StoredTransferJob::finished, this, &WcpotdProvider::imageRequestFinished);
-            return;
+            return QUrl(QLatin1String("https://commons.wikimedia.org/wiki/Special:FilePath/") + QString::fromUtf8(imageFile));
         }
-    }
 
-    emit error(this);
+        return QUrl();
+    });
 }
 
-void WcpotdProvider::imageRequestFinished(KJob *_job)
-{
-    KIO::StoredTransferJob *job = static_cast<KIO::StoredTransferJob *>( _job );
-    if ( job->error() ) {
-	emit error(this);
-	return;
-    }
-    QByteArray data = job->data();
-    mImage = QImage::fromData( data );
-    emit finished(this);
-}
+WcpotdProvider::~WcpotdProvider() = default;
 
 K_PLUGIN_CLASS_WITH_JSON(WcpotdProvider, "wcpotdprovider.json")
 
@@ -25,8 +25,6 @@
 // Qt
 #include <QImage>
 
-class KJob;
-
 /**
  * This class provides the image for the "Wikimedia 
  * Commons Picture Of the Day"
@@ -52,21 +50,6 @@ class WcpotdProvider : public PotdProvider
          * Destroys the Wcpotd provider.
          */
         ~WcpotdProvider() override;
-
-        /**
-         * Returns the requested image.
-         *
-         * Note: This method returns only a valid image after the
-         *       finished() signal has been emitted.
-         */
-        QImage image() const override;
-
-    private:
-        void pageRequestFinished(KJob *job);
-        void imageRequestFinished(KJob *job);
-
-    private:
-        QImage mImage;
 };
 
 #endif
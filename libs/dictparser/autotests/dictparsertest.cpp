@@ -0,0 +1,157 @@
+/*
+ *   Copyright (C) 2020 by the Plasma Addons authors
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Library General Public License as
+ *   published by the Free Software Foundation; either version 2, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details
+ *
+ *   You should have received a copy of the GNU Library General Public
+ *   License along with this program; if not, write to the
+ *   Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "dictparser.h"
+
+#include <QTest>
+
+namespace {
+
+// the answer of the dict server as the dict data engine wraps it
+QString wrap(const QString &entry)
+{
+    return QLatin1String("<dl>\n<dt>From WordNet (r) 3.0 (2006) [wn]:</dt>\n<dd><pre>\n") + entry + QLatin1String("</pre></dd>\n</dl>\n");
+}
+
+const char *const partsOfSpeech[] = { "n", "v", "adj", "adv" };
+
+// an entry the size of the one of "run", which has more than a hundred senses
+QString longEntry()
+{
+    QString entry = QStringLiteral("  run\n");
+    for (const char *partOfSpeech : partsOfSpeech) {
+        for (int sense = 1; sense <= 30; ++sense) {
+            entry += sense == 1 ? QStringLiteral("      %1 %2: ").arg(QLatin1String(partOfSpeech)).arg(sense)
+                                : QStringLiteral("         %1: ").arg(sense, 2);
+            entry += QStringLiteral("a score in baseball made by a runner touching all four bases\n"
+                                    "           safely; &quot;the Yankees scored 3 runs in the bottom of the\n"
+                                    "           9th&quot;; &quot;their first tally came in the 3rd inning&quot;\n"
+                                    "           [syn: {<a href=\"run\">run</a>}, {<a href=\"tally\">tally</a>}]\n");
+        }
+    }
+    return wrap(entry);
+}
+
+}
+
+class DictParserTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void definitions_data();
+    void definitions();
+    void benchmarkLongEntry();
+};
+
+void DictParserTest::definitions_data()
+{
+    QTest::addColumn<QString>("text");
+    QTest::addColumn<QStringList>("partsOfSpeech");
+    QTest::addColumn<QStringList>("texts");
+
+    QTest::newRow("bank") << wrap(QStringLiteral(
+        "  bank\n"
+        "      n 1: sloping land (especially the slope beside a body of water)\n"
+        "           [syn: {bank}, {side}]\n"
+        "      2: a long ridge or pile; &quot;a huge bank of earth&quot;\n"
+        "      v 1: tip laterally; &quot;the pilot had to bank the aircraft&quot;\n"))
+        << QStringList{ QStringLiteral("n"), QStringLiteral("n"), QStringLiteral("v") }
+        << QStringList{ QStringLiteral("sloping land (especially the slope beside a body of water) [syn: {bank}, {side}]"),
+                        QStringLiteral("a long ridge or pile; \"a huge bank of earth\""),
+                        QStringLiteral("tip laterally; \"the pilot had to bank the aircraft\"") };
+
+    QTest::newRow("adjective and adverb") << wrap(QStringLiteral(
+        "  fast\n"
+        "      adj 1: acting or moving or capable of acting or moving quickly;\n"
+        "             &quot;fast\tafoot&quot;\n"
+        "      adv 1: quickly or rapidly (often used as a combining form)\n"))
+        << QStringList{ QStringLiteral("adj"), QStringLiteral("adv") }
+        << QStringList{ QStringLiteral("acting or moving or capable of acting or moving quickly; \"fast afoot\""),
+                        QStringLiteral("quickly or rapidly (often used as a combining form)") };
+
+    QTest::newRow("tags spanning lines") << wrap(QStringLiteral(
+        "  side\n"
+        "      n 1: a place within a region identified relative to a center; see {<a\n"
+        "           href=\"bank\">bank</a>}\n"))
+        << QStringList{ QStringLiteral("n") }
+        << QStringList{ QStringLiteral("a place within a region identified relative to a center; see {bank}") };
+
+    QTest::newRow("entities") << wrap(QStringLiteral(
+        "  and\n"
+        "      n 1: the &lt;&amp;&gt; sign&nbsp;&nbsp;of &#39;and&#39; &copy; &unknownentity;\n"))
+        << QStringList{ QStringLiteral("n") }
+        << QStringList{ QStringLiteral("the <&> sign of 'and' &copy; &unknownentity;") };
+
+    // continuation lines never follow a blank line
+    QTest::newRow("blank line") << wrap(QStringLiteral(
+        "  bank\n"
+        "      n 1: sloping land\n"
+        "\n"
+        "           not part of it\n"))
+        << QStringList{ QStringLiteral("n") }
+        << QStringList{ QStringLiteral("sloping land") };
+
+    QTest::newRow("windows line ends") << wrap(QStringLiteral(
+        "  bank\r\n"
+        "      n 1: sloping land\r\n"
+        "           beside a body of water\r\n"))
+        << QStringList{ QStringLiteral("n") }
+        << QStringList{ QStringLiteral("sloping land beside a body of water") };
+
+    QTest::newRow("no definitions") << wrap(QStringLiteral("  bank\n"))
+        << QStringList() << QStringList();
+}
+
+void DictParserTest::definitions()
+{
+    QFETCH(QString, text);
+    QFETCH(QStringList, partsOfSpeech);
+    QFETCH(QStringList, texts);
+
+    const QVector<DictParser::Definition> definitions = DictParser::definitions(text);
+    QCOMPARE(definitions.count(), texts.count());
+    for (int i = 0; i < definitions.count(); ++i) {
+        QCOMPARE(definitions.at(i).partOfSpeech, partsOfSpeech.at(i));
+        QCOMPARE(definitions.at(i).text, texts.at(i));
+    }
+}
+
+void DictParserTest::benchmarkLongEntry()
+{
+    const QString text = longEntry();
+
+    QVector<DictParser::Definition> definitions;
+    QBENCHMARK {
+        definitions = DictParser::definitions(text);
+    }
+
+    QCOMPARE(definitions.count(), 4 * 30);
+    QCOMPARE(definitions.first().partOfSpeech, QStringLiteral("n"));
+    QCOMPARE(definitions.at(30).partOfSpeech, QStringLiteral("v"));
+    QCOMPARE(definitions.last().partOfSpeech, QStringLiteral("adv"));
+    QCOMPARE(definitions.last().text, QStringLiteral(
+        "a score in baseball made by a runner touching all four bases safely; "
+        "\"the Yankees scored 3 runs in the bottom of the 9th\"; \"their first tally came in the 3rd inning\" "
+        "[syn: {run}, {tally}]"));
+}
+
+QTEST_GUILESS_MAIN(DictParserTest)
+
+#include "dictparsertest.moc"
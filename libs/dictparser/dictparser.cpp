@@ -0,0 +1,197 @@
+/*
+ *   Copyright (C) 2020 by the Plasma Addons authors
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Library General Public License as
+ *   published by the Free Software Foundation; either version 2, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details
+ *
+ *   You should have received a copy of the GNU Library General Public
+ *   License along with this program; if not, write to the
+ *   Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "dictparser.h"
+
+namespace {
+
+struct Entity {
+    const char *name;
+    ushort character;
+};
+
+// the ones QString::toHtmlEscaped() produces, and the space
+const Entity entities[] = {
+    { "amp", '&' },
+    { "lt", '<' },
+    { "gt", '>' },
+    { "quot", '"' },
+    { "#39", '\'' },
+    { "nbsp", ' ' },
+};
+
+// longer entities are left as they are
+const int maxEntityLength = 5;
+
+bool isSpace(ushort c)
+{
+    return c == ' ' || c == '\t' || c == 0xa0;
+}
+
+/**
+ * Returns the number of characters the "n 12: " which starts a definition
+ * takes in @p line, and 0 if @p line does not start a definition. The part
+ * of speech is optional and has at most five letters, the number at most two
+ * digits, like in the dict format of WordNet.
+ */
+int definitionStart(const QString &line, QStringRef *partOfSpeech)
+{
+    const ushort *c = line.utf16();
+    const int size = line.size();
+
+    int i = 0;
+    while (i < size && c[i] >= 'a' && c[i] <= 'z') {
+        ++i;
+    }
+    const int letters = i;
+    if (letters > 5) {
+        return 0;
+    }
+    if (letters > 0) {
+        if (i == size || c[i] != ' ') {
+            return 0;
+        }
+        ++i;
+    }
+
+    const int number = i;
+    while (i < size && c[i] >= '0' && c[i] <= '9') {
+        ++i;
+    }
+    if (i == number || i - number > 2 || i == size || c[i] != ':') {
+        return 0;
+    }
+    ++i;
+    if (i < size && c[i] == ' ') {
+        ++i;
+    }
+
+    *partOfSpeech = line.leftRef(letters);
+    return i;
+}
+
+}
+
+namespace DictParser
+{
+
+QVector<Definition> definitions(const QString &text)
+{
+    QVector<Definition> result;
+
+    // the line being read, without tags and with single spaces only;
+    // reserving keeps its buffer when it is emptied for the next line
+    QString line;
+    line.reserve(256);
+
+    QString partOfSpeech;
+    bool headerSkipped = false;
+    bool inDefinition = false;
+    bool inTag = false;
+
+    auto endLine = [&]() {
+        if (line.endsWith(QLatin1Char(' '))) {
+            line.chop(1);
+        }
+
+        if (line.isEmpty()) {
+            // continuation lines never follow a blank line
+            inDefinition = false;
+        } else if (!headerSkipped) {
+            headerSkipped = true;
+        } else {
+            QStringRef name;
+            const int start = definitionStart(line, &name);
+            if (start > 0) {
+                if (!name.isEmpty()) {
+                    partOfSpeech = name.toString();
+                }
+                result.append({ partOfSpeech, line.mid(start) });
+                inDefinition = true;
+            } else if (inDefinition) {
+                QString &definition = result.last().text;
+                if (!definition.isEmpty()) {
+                    definition += QLatin1Char(' ');
+                }
+                definition += line;
+            }
+        }
+
+        line.resize(0);
+    };
+
+    auto appendSpace = [&line]() {
+        if (!line.isEmpty() && !line.endsWith(QLatin1Char(' '))) {
+            line += QLatin1Char(' ');
+        }
+    };
+
+    const ushort *c = text.utf16();
+    const int size = text.size();
+    for (int i = 0; i < size; ++i) {
+        const ushort ch = c[i];
+
+        // tags may span lines, so they are looked at first
+        if (inTag) {
+            inTag = ch != '>';
+            continue;
+        }
+
+        if (ch == '<') {
+            inTag = true;
+        } else if (ch == '\n') {
+            endLine();
+        } else if (ch == '\r') {
+            continue;
+        } else if (isSpace(ch)) {
+            appendSpace();
+        } else if (ch == '&') {
+            int end = i + 1;
+            while (end < size && end - i <= maxEntityLength + 1 && c[end] != ';') {
+                ++end;
+            }
+            ushort decoded = 0;
+            if (end < size && c[end] == ';') {
+                const QStringRef name = text.midRef(i + 1, end - i - 1);
+                for (const Entity &entity : entities) {
+                    if (name == QLatin1String(entity.name)) {
+                        decoded = entity.character;
+                        break;
+                    }
+                }
+            }
+            if (decoded == ' ') {
+                appendSpace();
+                i = end;
+            } else if (decoded) {
+                line += QChar(decoded);
+                i = end;
+            } else {
+                line += QLatin1Char('&');
+            }
+        } else {
+            line += QChar(ch);
+        }
+    }
+    endLine();
+
+    return result;
+}
+
+}
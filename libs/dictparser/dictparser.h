@@ -0,0 +1,62 @@
+/*
+ *   Copyright (C) 2020 by the Plasma Addons authors
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Library General Public License as
+ *   published by the Free Software Foundation; either version 2, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details
+ *
+ *   You should have received a copy of the GNU Library General Public
+ *   License along with this program; if not, write to the
+ *   Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef DICTPARSER_H
+#define DICTPARSER_H
+
+#include <QString>
+#include <QVector>
+
+/**
+ * Reads the definitions out of the text of the dict data engine, which is
+ * the answer of the dict server wrapped into HTML. A WordNet entry looks like
+ *
+ * @code
+ * From WordNet (r) 3.0 (2006) [wn]:
+ *
+ *   bank
+ *       n 1: sloping land (especially the slope beside a body of water)
+ *            [syn: {bank}, {side}]
+ *       2: a long ridge or pile; "a huge bank of earth"
+ *       v 1: tip laterally; "the pilot had to bank the aircraft"
+ * @endcode
+ *
+ * The text is read in a single pass without regular expressions: tags are
+ * dropped, entities decoded and runs of white space collapsed while going
+ * through it.
+ */
+namespace DictParser
+{
+
+struct Definition {
+    /// "n", "v", "adj", ...; that of the definition before if a line does not name it
+    QString partOfSpeech;
+    /// the definition, with its continuation lines joined
+    QString text;
+};
+
+/**
+ * Returns the definitions in @p text, in the order of the dict server.
+ * The first line, which names the database, is skipped.
+ */
+QVector<Definition> definitions(const QString &text);
+
+}
+
+#endif
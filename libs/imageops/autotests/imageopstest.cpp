@@ -0,0 +1,233 @@
+/*
+ *   Copyright (C) 2020 by the Plasma Addons authors
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Library General Public License as
+ *   published by the Free Software Foundation; either version 2, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details
+ *
+ *   You should have received a copy of the GNU Library General Public
+ *   License along with this program; if not, write to the
+ *   Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "imageops.h"
+#include "imageops_p.h"
+
+#include <QDebug>
+#include <QRandomGenerator>
+#include <QTest>
+
+#include <functional>
+
+typedef std::function<QImage(const QImage &)> Operation;
+
+Q_DECLARE_METATYPE(ImageOps::InstructionSet)
+Q_DECLARE_METATYPE(Operation)
+
+namespace {
+
+// noise, which has every value in every channel, in a size which leaves
+// pixels over after the SIMD code handled its two, four or eight at a time
+QImage noise(const QSize &size, QImage::Format format)
+{
+    QRandomGenerator random(size.width() * 1000 + size.height());
+    QImage image(size, QImage::Format_ARGB32);
+    for (int y = 0; y < image.height(); ++y) {
+        quint32 *line = reinterpret_cast<quint32 *>(image.scanLine(y));
+        for (int x = 0; x < image.width(); ++x) {
+            line[x] = random.generate();
+        }
+    }
+    return image.convertToFormat(format);
+}
+
+// the first pixel which differs, to tell an off-by-one from garbage
+QByteArray difference(const QImage &actual, const QImage &expected)
+{
+    if (actual.size() != expected.size() || actual.format() != expected.format()) {
+        return QByteArrayLiteral("size or format differ");
+    }
+    for (int y = 0; y < actual.height(); ++y) {
+        for (int x = 0; x < actual.width(); ++x) {
+            if (actual.pixel(x, y) != expected.pixel(x, y)) {
+                return QByteArray::number(x) + ',' + QByteArray::number(y) + ": " + QByteArray::number(actual.pixel(x, y), 16)
+                    + " instead of " + QByteArray::number(expected.pixel(x, y), 16);
+            }
+        }
+    }
+    return QByteArray();
+}
+
+}
+
+/**
+ * Compares the SSE2 and AVX2 code paths with the plain C++ one,
+ * and times ImageOps::downscaled() against QImage::scaled().
+ */
+class ImageOpsTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void cleanup();
+
+    void instructionSets_data();
+    void instructionSets();
+    void premultiplyLikeQt_data();
+    void premultiplyLikeQt();
+    void benchmarkDownscaled_data();
+    void benchmarkDownscaled();
+
+private:
+    ImageOps::InstructionSet m_supported = ImageOps::Scalar;
+};
+
+void ImageOpsTest::initTestCase()
+{
+    m_supported = ImageOps::setMaxInstructionSet(ImageOps::Avx2);
+    qDebug() << "supported instruction set:" << m_supported;
+}
+
+void ImageOpsTest::cleanup()
+{
+    ImageOps::setMaxInstructionSet(ImageOps::Avx2);
+}
+
+void ImageOpsTest::instructionSets_data()
+{
+    QTest::addColumn<ImageOps::InstructionSet>("instructionSet");
+    QTest::addColumn<QImage>("image");
+    QTest::addColumn<Operation>("operation");
+
+    const QSize size(257, 131);
+    const QList<QSize> targets = { QSize(100, 50), QSize(33, 131), QSize(257, 17), QSize(255, 129), QSize(1, 1) };
+
+    for (ImageOps::InstructionSet instructionSet : { ImageOps::Sse2, ImageOps::Avx2 }) {
+        const char *name = instructionSet == ImageOps::Sse2 ? "SSE2" : "AVX2";
+
+        for (QImage::Format format : { QImage::Format_RGB32, QImage::Format_ARGB32 }) {
+            const QImage image = noise(size, format);
+            const char *formatName = format == QImage::Format_RGB32 ? "RGB32" : "ARGB32";
+
+            for (const QSize &target : targets) {
+                QTest::addRow("%s, box, %s to %dx%d", name, formatName, target.width(), target.height())
+                    << instructionSet << image
+                    << Operation([target](const QImage &image) { return ImageOps::downscaled(image, target, ImageOps::Box); });
+                QTest::addRow("%s, lanczos, %s to %dx%d", name, formatName, target.width(), target.height())
+                    << instructionSet << image
+                    << Operation([target](const QImage &image) { return ImageOps::downscaled(image, target, ImageOps::Lanczos); });
+            }
+            QTest::addRow("%s, RGB888, %s", name, formatName)
+                << instructionSet << image << Operation(&ImageOps::toRgb888);
+        }
+
+        for (int width = 1; width <= 9; ++width) {
+            QTest::addRow("%s, premultiply %d pixels", name, width)
+                << instructionSet << noise(QSize(width, 3), QImage::Format_ARGB32) << Operation(&ImageOps::toPremultiplied);
+        }
+    }
+}
+
+void ImageOpsTest::instructionSets()
+{
+    QFETCH(ImageOps::InstructionSet, instructionSet);
+    QFETCH(QImage, image);
+    QFETCH(Operation, operation);
+
+    if (instructionSet > m_supported) {
+        QSKIP("not supported by this CPU or compiler");
+    }
+
+    ImageOps::setMaxInstructionSet(ImageOps::Scalar);
+    const QImage expected = operation(image);
+    QCOMPARE(ImageOps::setMaxInstructionSet(instructionSet), instructionSet);
+    const QImage actual = operation(image);
+
+    const QByteArray message = difference(actual, expected);
+    QVERIFY2(message.isEmpty(), message.constData());
+}
+
+void ImageOpsTest::premultiplyLikeQt_data()
+{
+    QTest::addColumn<ImageOps::InstructionSet>("instructionSet");
+
+    QTest::newRow("scalar") << ImageOps::Scalar;
+    QTest::newRow("SSE2") << ImageOps::Sse2;
+    QTest::newRow("AVX2") << ImageOps::Avx2;
+}
+
+void ImageOpsTest::premultiplyLikeQt()
+{
+    QFETCH(ImageOps::InstructionSet, instructionSet);
+
+    if (instructionSet > m_supported) {
+        QSKIP("not supported by this CPU or compiler");
+    }
+    ImageOps::setMaxInstructionSet(instructionSet);
+
+    // every combination of a channel value and an alpha value
+    QImage image(256, 256, QImage::Format_ARGB32);
+    for (int alpha = 0; alpha < 256; ++alpha) {
+        quint32 *line = reinterpret_cast<quint32 *>(image.scanLine(alpha));
+        for (int value = 0; value < 256; ++value) {
+            line[value] = qRgba(value, 255 - value, value / 2, alpha);
+        }
+    }
+
+    QImage expected(image.size(), QImage::Format_ARGB32_Premultiplied);
+    for (int y = 0; y < image.height(); ++y) {
+        const quint32 *src = reinterpret_cast<const quint32 *>(image.constScanLine(y));
+        quint32 *dst = reinterpret_cast<quint32 *>(expected.scanLine(y));
+        for (int x = 0; x < image.width(); ++x) {
+            dst[x] = qPremultiply(src[x]);
+        }
+    }
+
+    const QByteArray message = difference(ImageOps::toPremultiplied(image), expected);
+    QVERIFY2(message.isEmpty(), message.constData());
+}
+
+void ImageOpsTest::benchmarkDownscaled_data()
+{
+    QTest::addColumn<QSize>("size");
+    QTest::addColumn<Operation>("operation");
+
+    // a UHD wallpaper shown on a full HD screen, and as a thumbnail
+    for (const QSize &size : { QSize(1920, 1080), QSize(400, 225) }) {
+        const QByteArray suffix = ' ' + QByteArray::number(size.width()) + 'x' + QByteArray::number(size.height());
+        QTest::newRow(QByteArray("ImageOps box" + suffix).constData()) << size
+            << Operation([size](const QImage &image) { return ImageOps::downscaled(image, size, ImageOps::Box); });
+        QTest::newRow(QByteArray("ImageOps lanczos" + suffix).constData()) << size
+            << Operation([size](const QImage &image) { return ImageOps::downscaled(image, size, ImageOps::Lanczos); });
+        QTest::newRow(QByteArray("QImage smooth" + suffix).constData()) << size
+            << Operation([size](const QImage &image) { return image.scaled(size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation); });
+        QTest::newRow(QByteArray("QImage fast" + suffix).constData()) << size
+            << Operation([size](const QImage &image) { return image.scaled(size, Qt::IgnoreAspectRatio, Qt::FastTransformation); });
+    }
+}
+
+void ImageOpsTest::benchmarkDownscaled()
+{
+    QFETCH(QSize, size);
+    QFETCH(Operation, operation);
+
+    const QImage image = noise(QSize(3840, 2160), QImage::Format_RGB32);
+
+    QImage result;
+    QBENCHMARK {
+        result = operation(image);
+    }
+    QCOMPARE(result.size(), size);
+}
+
+QTEST_GUILESS_MAIN(ImageOpsTest)
+
+#include "imageopstest.moc"
@@ -0,0 +1,598 @@
+/*
+ *   Copyright (C) 2020 by the Plasma Addons authors
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Library General Public License as
+ *   published by the Free Software Foundation; either version 2, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details
+ *
+ *   You should have received a copy of the GNU Library General Public
+ *   License along with this program; if not, write to the
+ *   Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "imageops.h"
+#include "imageops_p.h"
+
+#include <QVector>
+#include <QtMath>
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define IMAGEOPS_SSE2
+#include <emmintrin.h>
+#endif
+
+// AVX2 is picked at runtime, which needs the target attribute of GCC and Clang
+#if defined(IMAGEOPS_SSE2) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define IMAGEOPS_AVX2
+#include <immintrin.h>
+#define IMAGEOPS_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace {
+
+// lowered by the autotests only
+ImageOps::InstructionSet maxInstructionSet = ImageOps::Avx2;
+
+// weights are fixed point numbers with this many fractional bits; they have
+// to fit into 16 bits for _mm_madd_epi16, including the negative lobes of Lanczos
+const int precisionBits = 14;
+const int rounding = 1 << (precisionBits - 1);
+
+/**
+ * The source pixels which make up each pixel of a scaled row or column:
+ * count[i] pixels from start[i] on, weighted by the taps at i * maxTaps.
+ */
+struct Contributions {
+    int maxTaps = 0;
+    QVector<int> start;
+    QVector<int> count;
+    QVector<qint16> weights;
+};
+
+double boxFilter(double x)
+{
+    return x >= -0.5 && x < 0.5 ? 1.0 : 0.0;
+}
+
+double sinc(double x)
+{
+    if (x == 0.0) {
+        return 1.0;
+    }
+    x *= M_PI;
+    return std::sin(x) / x;
+}
+
+double lanczosFilter(double x)
+{
+    return x > -3.0 && x < 3.0 ? sinc(x) * sinc(x / 3.0) : 0.0;
+}
+
+Contributions contributions(int inSize, int outSize, ImageOps::Filter filter)
+{
+    const double scale = double(inSize) / outSize;
+    const double support = (filter == ImageOps::Lanczos ? 3.0 : 0.5) * scale;
+    double (*kernel)(double) = filter == ImageOps::Lanczos ? lanczosFilter : boxFilter;
+
+    Contributions c;
+    c.maxTaps = int(std::ceil(support)) * 2 + 1;
+    c.start.resize(outSize);
+    c.count.resize(outSize);
+    c.weights.fill(0, outSize * c.maxTaps);
+
+    QVector<double> taps(c.maxTaps);
+    for (int i = 0; i < outSize; ++i) {
+        const double center = (i + 0.5) * scale;
+        const int first = std::max(int(center - support + 0.5), 0);
+        const int last = std::min(int(center + support + 0.5), inSize);
+
+        double sum = 0.0;
+        int count = 0;
+        for (int j = first; j < last && count < c.maxTaps; ++j, ++count) {
+            taps[count] = kernel((j + 0.5 - center) / scale);
+            sum += taps[count];
+        }
+
+        // the rounded weights have to add up to exactly one,
+        // or a plain colour would not stay the same
+        qint16 *weights = c.weights.data() + i * c.maxTaps;
+        int total = 0;
+        int largest = 0;
+        for (int k = 0; k < count; ++k) {
+            weights[k] = qint16(std::lround(taps[k] / sum * (1 << precisionBits)));
+            total += weights[k];
+            if (weights[k] > weights[largest]) {
+                largest = k;
+            }
+        }
+        weights[largest] += (1 << precisionBits) - total;
+
+        c.start[i] = first;
+        c.count[i] = count;
+    }
+
+    return c;
+}
+
+inline uint clampChannel(int value)
+{
+    value >>= precisionBits;
+    return uint(value < 0 ? 0 : (value > 255 ? 255 : value));
+}
+
+// the channels are handled alike, so this works for any byte order
+inline void accumulate(int *acc, quint32 pixel, int weight)
+{
+    acc[0] += int(pixel & 0xff) * weight;
+    acc[1] += int((pixel >> 8) & 0xff) * weight;
+    acc[2] += int((pixel >> 16) & 0xff) * weight;
+    acc[3] += int(pixel >> 24) * weight;
+}
+
+inline quint32 pack(const int *acc)
+{
+    return clampChannel(acc[0]) | clampChannel(acc[1]) << 8 | clampChannel(acc[2]) << 16 | clampChannel(acc[3]) << 24;
+}
+
+void scaleRowScalar(const quint32 *src, quint32 *dst, const Contributions &c)
+{
+    for (int x = 0; x < c.start.count(); ++x) {
+        const quint32 *pixels = src + c.start[x];
+        const qint16 *weights = c.weights.constData() + x * c.maxTaps;
+        int acc[4] = { rounding, rounding, rounding, rounding };
+        for (int k = 0; k < c.count[x]; ++k) {
+            accumulate(acc, pixels[k], weights[k]);
+        }
+        dst[x] = pack(acc);
+    }
+}
+
+void scaleColumnScalar(const quint32 *const *rows, const qint16 *weights, int count, quint32 *dst, int first, int width)
+{
+    for (int x = first; x < width; ++x) {
+        int acc[4] = { rounding, rounding, rounding, rounding };
+        for (int k = 0; k < count; ++k) {
+            accumulate(acc, rows[k][x], weights[k]);
+        }
+        dst[x] = pack(acc);
+    }
+}
+
+#ifdef IMAGEOPS_SSE2
+// two weights in every 32 bit lane, to go with pixels of two rows or columns
+// whose bytes are interleaved
+inline __m128i weightPair(qint16 first, qint16 second)
+{
+    return _mm_set1_epi32(int(quint32(quint16(first)) | quint32(quint16(second)) << 16));
+}
+
+inline quint32 packPixel(__m128i acc)
+{
+    acc = _mm_srai_epi32(acc, precisionBits);
+    acc = _mm_packs_epi32(acc, acc);
+    acc = _mm_packus_epi16(acc, acc);
+    return quint32(_mm_cvtsi128_si32(acc));
+}
+
+inline __m128i accumulatePair(__m128i acc, quint32 first, quint32 second, __m128i weights)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i pixels = _mm_unpacklo_epi8(_mm_cvtsi32_si128(int(first)), _mm_cvtsi32_si128(int(second)));
+    pixels = _mm_unpacklo_epi8(pixels, zero);
+    return _mm_add_epi32(acc, _mm_madd_epi16(pixels, weights));
+}
+
+void scaleRowSse2(const quint32 *src, quint32 *dst, const Contributions &c)
+{
+    for (int x = 0; x < c.start.count(); ++x) {
+        const quint32 *pixels = src + c.start[x];
+        const qint16 *weights = c.weights.constData() + x * c.maxTaps;
+        const int count = c.count[x];
+
+        __m128i acc = _mm_set1_epi32(rounding);
+        int k = 0;
+        for (; k + 1 < count; k += 2) {
+            acc = accumulatePair(acc, pixels[k], pixels[k + 1], weightPair(weights[k], weights[k + 1]));
+        }
+        if (k < count) {
+            acc = accumulatePair(acc, pixels[k], 0, weightPair(weights[k], 0));
+        }
+        dst[x] = packPixel(acc);
+    }
+}
+
+void scaleColumnSse2(const quint32 *const *rows, const qint16 *weights, int count, quint32 *dst, int first, int width)
+{
+    const __m128i zero = _mm_setzero_si128();
+    int x = first;
+    // two pixels at a time
+    for (; x + 1 < width; x += 2) {
+        __m128i accLow = _mm_set1_epi32(rounding);
+        __m128i accHigh = accLow;
+        for (int k = 0; k < count; k += 2) {
+            const bool pair = k + 1 < count;
+            const __m128i upper = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(rows[k] + x));
+            const __m128i lower = pair ? _mm_loadl_epi64(reinterpret_cast<const __m128i *>(rows[k + 1] + x)) : zero;
+            const __m128i interleaved = _mm_unpacklo_epi8(upper, lower);
+            const __m128i w = weightPair(weights[k], pair ? weights[k + 1] : 0);
+            accLow = _mm_add_epi32(accLow, _mm_madd_epi16(_mm_unpacklo_epi8(interleaved, zero), w));
+            accHigh = _mm_add_epi32(accHigh, _mm_madd_epi16(_mm_unpackhi_epi8(interleaved, zero), w));
+        }
+        accLow = _mm_packs_epi32(_mm_srai_epi32(accLow, precisionBits), _mm_srai_epi32(accHigh, precisionBits));
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(dst + x), _mm_packus_epi16(accLow, accLow));
+    }
+    scaleColumnScalar(rows, weights, count, dst, x, width);
+}
+
+void premultiplySse2(const quint32 *src, quint32 *dst, int width, int &done)
+{
+    const __m128i zero = _mm_setzero_si128();
+    // keeps the alpha channel itself as it is
+    const __m128i alphaMask = _mm_set_epi16(0xff, 0, 0, 0, 0xff, 0, 0, 0);
+    const __m128i half = _mm_set1_epi16(0x80);
+
+    auto premultiply = [&](__m128i pixels) {
+        __m128i alpha = _mm_shufflelo_epi16(pixels, _MM_SHUFFLE(3, 3, 3, 3));
+        alpha = _mm_shufflehi_epi16(alpha, _MM_SHUFFLE(3, 3, 3, 3));
+        alpha = _mm_or_si128(alpha, alphaMask);
+        // x * a / 255, rounded the way qPremultiply() does it, so the
+        // pixels do not depend on the width of the image
+        const __m128i t = _mm_mullo_epi16(pixels, alpha);
+        return _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), half), 8);
+    };
+
+    int x = 0;
+    for (; x + 3 < width; x += 4) {
+        const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x));
+        const __m128i low = premultiply(_mm_unpacklo_epi8(pixels, zero));
+        const __m128i high = premultiply(_mm_unpackhi_epi8(pixels, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x), _mm_packus_epi16(low, high));
+    }
+    done = x;
+}
+#endif
+
+#ifdef IMAGEOPS_AVX2
+IMAGEOPS_TARGET_AVX2
+void scaleRowAvx2(const quint32 *src, quint32 *dst, const Contributions &c)
+{
+    // interleaves the bytes of pixels 0 and 1, and of pixels 2 and 3
+    const __m128i interleave = _mm_setr_epi8(0, 4, 1, 5, 2, 6, 3, 7, 8, 12, 9, 13, 10, 14, 11, 15);
+
+    for (int x = 0; x < c.start.count(); ++x) {
+        const quint32 *pixels = src + c.start[x];
+        const qint16 *weights = c.weights.constData() + x * c.maxTaps;
+        const int count = c.count[x];
+
+        __m256i acc4 = _mm256_setzero_si256();
+        int k = 0;
+        for (; k + 3 < count; k += 4) {
+            const __m128i quad = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + k)), interleave);
+            const __m256i w = _mm256_inserti128_si256(_mm256_castsi128_si256(weightPair(weights[k], weights[k + 1])),
+                                                      weightPair(weights[k + 2], weights[k + 3]), 1);
+            acc4 = _mm256_add_epi32(acc4, _mm256_madd_epi16(_mm256_cvtepu8_epi16(quad), w));
+        }
+
+        __m128i acc = _mm_add_epi32(_mm_set1_epi32(rounding),
+                                    _mm_add_epi32(_mm256_castsi256_si128(acc4), _mm256_extracti128_si256(acc4, 1)));
+        for (; k + 1 < count; k += 2) {
+            acc = accumulatePair(acc, pixels[k], pixels[k + 1], weightPair(weights[k], weights[k + 1]));
+        }
+        if (k < count) {
+            acc = accumulatePair(acc, pixels[k], 0, weightPair(weights[k], 0));
+        }
+        dst[x] = packPixel(acc);
+    }
+}
+
+IMAGEOPS_TARGET_AVX2
+void scaleColumnAvx2(const quint32 *const *rows, const qint16 *weights, int count, quint32 *dst, int first, int width)
+{
+    const __m128i zero = _mm_setzero_si128();
+    int x = first;
+    // four pixels at a time
+    for (; x + 3 < width; x += 4) {
+        __m256i accLow = _mm256_set1_epi32(rounding);
+        __m256i accHigh = accLow;
+        for (int k = 0; k < count; k += 2) {
+            const bool pair = k + 1 < count;
+            const __m128i upper = _mm_loadu_si128(reinterpret_cast<const __m128i *>(rows[k] + x));
+            const __m128i lower = pair ? _mm_loadu_si128(reinterpret_cast<const __m128i *>(rows[k + 1] + x)) : zero;
+            const __m256i w = _mm256_set1_epi32(int(quint32(quint16(weights[k])) | quint32(quint16(pair ? weights[k + 1] : 0)) << 16));
+            accLow = _mm256_add_epi32(accLow, _mm256_madd_epi16(_mm256_cvtepu8_epi16(_mm_unpacklo_epi8(upper, lower)), w));
+            accHigh = _mm256_add_epi32(accHigh, _mm256_madd_epi16(_mm256_cvtepu8_epi16(_mm_unpackhi_epi8(upper, lower)), w));
+        }
+        accLow = _mm256_srai_epi32(accLow, precisionBits);
+        accHigh = _mm256_srai_epi32(accHigh, precisionBits);
+        const __m128i low = _mm_packs_epi32(_mm256_castsi256_si128(accLow), _mm256_extracti128_si256(accLow, 1));
+        const __m128i high = _mm_packs_epi32(_mm256_castsi256_si128(accHigh), _mm256_extracti128_si256(accHigh, 1));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x), _mm_packus_epi16(low, high));
+    }
+    scaleColumnSse2(rows, weights, count, dst, x, width);
+}
+
+IMAGEOPS_TARGET_AVX2
+void toRgb888Avx2(const quint32 *src, uchar *dst, int width, int &done)
+{
+    // BGRA in memory to RGB, the last four bytes are overwritten by the next round
+    const __m128i shuffle = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    int x = 0;
+    for (; x + 5 < width; x += 4) {
+        const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x * 3), _mm_shuffle_epi8(pixels, shuffle));
+    }
+    done = x;
+}
+
+bool hasAvx2()
+{
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported && maxInstructionSet >= ImageOps::Avx2;
+}
+#endif
+
+#ifdef IMAGEOPS_SSE2
+bool hasSse2()
+{
+    return maxInstructionSet >= ImageOps::Sse2;
+}
+#endif
+
+typedef void (*RowScaler)(const quint32 *src, quint32 *dst, const Contributions &c);
+typedef void (*ColumnScaler)(const quint32 *const *rows, const qint16 *weights, int count, quint32 *dst, int first, int width);
+
+RowScaler rowScaler()
+{
+#ifdef IMAGEOPS_AVX2
+    if (hasAvx2()) {
+        return scaleRowAvx2;
+    }
+#endif
+#ifdef IMAGEOPS_SSE2
+    if (hasSse2()) {
+        return scaleRowSse2;
+    }
+#endif
+    return scaleRowScalar;
+}
+
+ColumnScaler columnScaler()
+{
+#ifdef IMAGEOPS_AVX2
+    if (hasAvx2()) {
+        return scaleColumnAvx2;
+    }
+#endif
+#ifdef IMAGEOPS_SSE2
+    if (hasSse2()) {
+        return scaleColumnSse2;
+    }
+#endif
+    return scaleColumnScalar;
+}
+
+QImage scaleHorizontally(const QImage &src, int width, ImageOps::Filter filter)
+{
+    const Contributions c = contributions(src.width(), width, filter);
+    const RowScaler scale = rowScaler();
+
+    QImage dst(width, src.height(), src.format());
+    for (int y = 0; y < src.height(); ++y) {
+        scale(reinterpret_cast<const quint32 *>(src.constScanLine(y)), reinterpret_cast<quint32 *>(dst.scanLine(y)), c);
+    }
+    return dst;
+}
+
+QImage scaleVertically(const QImage &src, int height, ImageOps::Filter filter)
+{
+    const Contributions c = contributions(src.height(), height, filter);
+    const ColumnScaler scale = columnScaler();
+
+    QImage dst(src.width(), height, src.format());
+    QVector<const quint32 *> rows(c.maxTaps);
+    for (int y = 0; y < height; ++y) {
+        for (int k = 0; k < c.count[y]; ++k) {
+            rows[k] = reinterpret_cast<const quint32 *>(src.constScanLine(c.start[y] + k));
+        }
+        scale(rows.constData(), c.weights.constData() + y * c.maxTaps, c.count[y],
+              reinterpret_cast<quint32 *>(dst.scanLine(y)), 0, src.width());
+    }
+    return dst;
+}
+
+// one pass of a box blur over @p count pixels which are @p step apart,
+// keeping a running sum so the cost does not depend on the radius
+void boxBlur(quint32 *pixels, int count, int step, int radius, QVector<quint32> &line)
+{
+    line.resize(count);
+    for (int i = 0; i < count; ++i) {
+        line[i] = pixels[i * step];
+    }
+
+    const quint64 size = 2 * radius + 1;
+    // 2^32 / size, so the division is a multiplication and a shift
+    const quint64 scale = ((quint64(1) << 32) + size / 2) / size;
+    const quint64 half = quint64(1) << 31;
+    auto average = [scale, half](uint sum) {
+        return quint32((sum * scale + half) >> 32);
+    };
+    uint sum[4] = { 0, 0, 0, 0 };
+    auto add = [&sum](quint32 p, int factor) {
+        sum[0] += (p & 0xff) * factor;
+        sum[1] += ((p >> 8) & 0xff) * factor;
+        sum[2] += ((p >> 16) & 0xff) * factor;
+        sum[3] += (p >> 24) * factor;
+    };
+    auto remove = [&sum](quint32 p) {
+        sum[0] -= p & 0xff;
+        sum[1] -= (p >> 8) & 0xff;
+        sum[2] -= (p >> 16) & 0xff;
+        sum[3] -= p >> 24;
+    };
+
+    // the edge pixels are repeated beyond the edges
+    const int last = count - 1;
+    add(line[0], radius + 1);
+    for (int i = 1; i <= radius; ++i) {
+        add(line[std::min(i, last)], 1);
+    }
+
+    for (int i = 0; i < count; ++i) {
+        pixels[i * step] = average(sum[0]) | average(sum[1]) << 8 | average(sum[2]) << 16 | average(sum[3]) << 24;
+        add(line[std::min(i + radius + 1, last)], 1);
+        remove(line[std::max(i - radius, 0)]);
+    }
+}
+
+// the negative lobes of Lanczos can leave colours larger than their alpha;
+// opaque pixels stay opaque, as the weights add up to exactly one
+void clampToAlpha(QImage &image)
+{
+    for (int y = 0; y < image.height(); ++y) {
+        QRgb *line = reinterpret_cast<QRgb *>(image.scanLine(y));
+        for (int x = 0; x < image.width(); ++x) {
+            const int alpha = qAlpha(line[x]);
+            line[x] = qRgba(std::min(qRed(line[x]), alpha), std::min(qGreen(line[x]), alpha),
+                            std::min(qBlue(line[x]), alpha), alpha);
+        }
+    }
+}
+
+}
+
+namespace ImageOps
+{
+
+QImage downscaled(const QImage &image, const QSize &size, Filter filter)
+{
+    if (image.isNull() || size.isEmpty()) {
+        return QImage();
+    }
+
+    QImage result = toDisplayFormat(image);
+
+    // the larger reduction first, so the second pass has less to do
+    const bool horizontalFirst = double(size.width()) / result.width() <= double(size.height()) / result.height();
+    for (int pass = 0; pass < 2; ++pass) {
+        if ((pass == 0) == horizontalFirst) {
+            if (size.width() < result.width()) {
+                result = scaleHorizontally(result, size.width(), filter);
+            }
+        } else if (size.height() < result.height()) {
+            result = scaleVertically(result, size.height(), filter);
+        }
+    }
+
+    if (filter == Lanczos && result.format() == QImage::Format_ARGB32_Premultiplied) {
+        clampToAlpha(result);
+    }
+    return result;
+}
+
+QImage blurred(const QImage &image, int radius)
+{
+    QImage result = toDisplayFormat(image);
+    if (result.isNull() || radius < 1) {
+        return result;
+    }
+    // keeps the sums well within 32 bits
+    radius = std::min(radius, 4096);
+
+    const int width = result.width();
+    const int height = result.height();
+    const int stride = result.bytesPerLine() / 4;
+    quint32 *pixels = reinterpret_cast<quint32 *>(result.bits());
+    QVector<quint32> line;
+    for (int pass = 0; pass < 3; ++pass) {
+        for (int y = 0; y < height; ++y) {
+            boxBlur(pixels + y * stride, width, 1, radius, line);
+        }
+        for (int x = 0; x < width; ++x) {
+            boxBlur(pixels + x, height, stride, radius, line);
+        }
+    }
+    return result;
+}
+
+InstructionSet setMaxInstructionSet(InstructionSet instructionSet)
+{
+    maxInstructionSet = instructionSet;
+#ifdef IMAGEOPS_AVX2
+    if (hasAvx2()) {
+        return Avx2;
+    }
+#endif
+#ifdef IMAGEOPS_SSE2
+    if (hasSse2()) {
+        return Sse2;
+    }
+#endif
+    return Scalar;
+}
+
+QImage toPremultiplied(const QImage &image)
+{
+    if (image.format() != QImage::Format_ARGB32) {
+        return image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    }
+
+    QImage result(image.size(), QImage::Format_ARGB32_Premultiplied);
+    for (int y = 0; y < image.height(); ++y) {
+        const quint32 *src = reinterpret_cast<const quint32 *>(image.constScanLine(y));
+        quint32 *dst = reinterpret_cast<quint32 *>(result.scanLine(y));
+        int x = 0;
+#if defined(IMAGEOPS_SSE2) && Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+        if (hasSse2()) {
+            premultiplySse2(src, dst, image.width(), x);
+        }
+#endif
+        for (; x < image.width(); ++x) {
+            dst[x] = qPremultiply(src[x]);
+        }
+    }
+    result.setDevicePixelRatio(image.devicePixelRatio());
+    return result;
+}
+
+QImage toDisplayFormat(const QImage &image)
+{
+    return image.hasAlphaChannel() ? toPremultiplied(image) : image.convertToFormat(QImage::Format_RGB32);
+}
+
+QImage toRgb888(const QImage &image)
+{
+    if (image.format() != QImage::Format_RGB32 && image.format() != QImage::Format_ARGB32) {
+        return image.convertToFormat(QImage::Format_RGB888);
+    }
+
+    QImage result(image.size(), QImage::Format_RGB888);
+    for (int y = 0; y < image.height(); ++y) {
+        const quint32 *src = reinterpret_cast<const quint32 *>(image.constScanLine(y));
+        uchar *dst = result.scanLine(y);
+        int x = 0;
+#if defined(IMAGEOPS_AVX2) && Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+        if (hasAvx2()) {
+            toRgb888Avx2(src, dst, image.width(), x);
+        }
+#endif
+        for (; x < image.width(); ++x) {
+            dst[x * 3] = uchar(qRed(src[x]));
+            dst[x * 3 + 1] = uchar(qGreen(src[x]));
+            dst[x * 3 + 2] = uchar(qBlue(src[x]));
+        }
+    }
+    result.setDevicePixelRatio(image.devicePixelRatio());
+    return result;
+}
+
+}
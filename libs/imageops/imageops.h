@@ -0,0 +1,84 @@
+/*
+ *   Copyright (C) 2020 by the Plasma Addons authors
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Library General Public License as
+ *   published by the Free Software Foundation; either version 2, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details
+ *
+ *   You should have received a copy of the GNU Library General Public
+ *   License along with this program; if not, write to the
+ *   Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef IMAGEOPS_H
+#define IMAGEOPS_H
+
+#include <QImage>
+
+/**
+ * Image operations for pictures which are much larger than they are shown,
+ * like wallpapers and comic strips.
+ *
+ * They are meant to be called from worker threads, so the GUI thread only
+ * has to upload a picture of the right size in the right format. The inner
+ * loops use SSE2 or AVX2 where the CPU supports it, and plain C++ otherwise.
+ * All functions are reentrant.
+ */
+namespace ImageOps
+{
+
+enum Filter {
+    Box,     ///< averages all source pixels covered by a pixel, fast and free of aliasing
+    Lanczos  ///< Lanczos-3, sharper, for pictures which are looked at closely
+};
+
+/**
+ * Returns @p image scaled to @p size, ignoring the aspect ratio.
+ * Dimensions which are not smaller than those of @p image are left
+ * untouched, so this never scales up.
+ *
+ * The result is in Format_ARGB32_Premultiplied if @p image has an alpha
+ * channel, and in Format_RGB32 otherwise.
+ */
+QImage downscaled(const QImage &image, const QSize &size, Filter filter = Box);
+
+/**
+ * Returns @p image blurred with three passes of a box blur of @p radius in
+ * each direction, which comes close to a gaussian blur. It only uses integer
+ * arithmetic and takes the same time for any radius.
+ *
+ * The result is in the same format as that of downscaled(). Blurring a
+ * downscaled copy and scaling it up again when drawing looks almost the
+ * same, and is much cheaper for large radii.
+ */
+QImage blurred(const QImage &image, int radius);
+
+/**
+ * Returns @p image in Format_ARGB32_Premultiplied, the format which
+ * QPainter and the scene graph draw without converting it first.
+ */
+QImage toPremultiplied(const QImage &image);
+
+/**
+ * Returns @p image in the format it is drawn fastest in: premultiplied
+ * if it has an alpha channel, and Format_RGB32 otherwise. Indexed images,
+ * like many comic strips, are converted on every paint otherwise.
+ */
+QImage toDisplayFormat(const QImage &image);
+
+/**
+ * Returns @p image in Format_RGB888, dropping the alpha channel,
+ * which takes a quarter less memory for opaque pictures.
+ */
+QImage toRgb888(const QImage &image);
+
+}
+
+#endif
@@ -0,0 +1,43 @@
+/*
+ *   Copyright (C) 2020 by the Plasma Addons authors
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Library General Public License as
+ *   published by the Free Software Foundation; either version 2, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details
+ *
+ *   You should have received a copy of the GNU Library General Public
+ *   License along with this program; if not, write to the
+ *   Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+#ifndef IMAGEOPS_P_H
+#define IMAGEOPS_P_H
+
+namespace ImageOps
+{
+
+enum InstructionSet {
+    Scalar,
+    Sse2,
+    Avx2
+};
+
+/**
+ * Restricts the functions to @p instructionSet and those below it, so the
+ * autotests can compare each code path with the plain C++ one. Returns the
+ * instruction set which is used from now on, which is @p instructionSet
+ * unless the CPU or the compiler does not support it.
+ *
+ * Not thread-safe: only call it while no other thread uses ImageOps.
+ */
+InstructionSet setMaxInstructionSet(InstructionSet instructionSet);
+
+}
+
+#endif
@@ -0,0 +1,390 @@
+/* Copyright 2020  Plasma Addons authors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) version 3, or any
+ * later version accepted by the membership of KDE e.V. (or its
+ * successor approved by the membership of KDE e.V.), which shall
+ * act as a proxy defined in Section 6 of version 3 of the license.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "charnames.h"
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+
+namespace {
+
+const char magic[8] = { 'C', 'H', 'R', 'N', 'A', 'M', 'E', 'S' };
+const uint32_t formatVersion = 1;
+
+// magic, version and the four counts
+const size_t headerSize = 8 + 5 * 4;
+const size_t entrySize = 8;
+const size_t wordSize = 8;
+const size_t postingSize = 4;
+
+// typos are only tolerated in words of this length, shorter ones match too much
+const size_t minTypoLength = 4;
+
+uint32_t readNumber(const char *data)
+{
+    const unsigned char *bytes = reinterpret_cast<const unsigned char *>(data);
+    return uint32_t(bytes[0]) | uint32_t(bytes[1]) << 8 | uint32_t(bytes[2]) << 16 | uint32_t(bytes[3]) << 24;
+}
+
+void writeNumber(std::string *out, uint32_t number)
+{
+    for (int i = 0; i < 4; ++i) {
+        out->push_back(char(number >> (8 * i)));
+    }
+}
+
+bool isSeparator(char c)
+{
+    return c == ' ' || c == '-';
+}
+
+bool startsWith(const char *text, size_t length, const std::string &prefix)
+{
+    return length >= prefix.size() && std::memcmp(text, prefix.data(), prefix.size()) == 0;
+}
+
+// whether @p a turns into @p b by inserting, removing, replacing or swapping one letter
+bool withinOneEdit(const char *a, size_t aLength, const char *b, size_t bLength)
+{
+    if (aLength > bLength) {
+        std::swap(a, b);
+        std::swap(aLength, bLength);
+    }
+    if (bLength - aLength > 1) {
+        return false;
+    }
+
+    size_t i = 0;
+    while (i < aLength && a[i] == b[i]) {
+        ++i;
+    }
+    if (i == aLength) {
+        return true;
+    }
+
+    if (aLength < bLength) {
+        return std::memcmp(a + i, b + i + 1, aLength - i) == 0;
+    }
+    if (std::memcmp(a + i + 1, b + i + 1, aLength - i - 1) == 0) {
+        return true;
+    }
+    return i + 1 < aLength && a[i] == b[i + 1] && a[i + 1] == b[i]
+        && std::memcmp(a + i + 2, b + i + 2, aLength - i - 2) == 0;
+}
+
+// whether @p word starts with @p prefix, allowing for one typo
+bool startsWithTypo(const char *word, size_t length, const std::string &prefix)
+{
+    const size_t from = prefix.size() - 1;
+    for (size_t size = from; size <= prefix.size() + 1 && size <= length; ++size) {
+        if (withinOneEdit(prefix.data(), prefix.size(), word, size)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// whether a word of @p name starts with @p prefix
+bool hasWord(const char *name, const std::string &prefix, bool typos)
+{
+    const char *start = name;
+    while (*start) {
+        const char *end = start;
+        while (*end && !isSeparator(*end)) {
+            ++end;
+        }
+        const size_t length = size_t(end - start);
+        if (typos ? startsWithTypo(start, length, prefix) : startsWith(start, length, prefix)) {
+            return true;
+        }
+        start = *end ? end + 1 : end;
+    }
+    return false;
+}
+
+}
+
+namespace CharNames
+{
+
+std::vector<std::string> splitWords(const std::string &text)
+{
+    std::vector<std::string> words;
+    std::string word;
+    for (char c : text) {
+        if (isSeparator(c) || c == '\t') {
+            if (!word.empty()) {
+                words.push_back(word);
+                word.clear();
+            }
+            continue;
+        }
+        word.push_back(c >= 'a' && c <= 'z' ? char(c - 'a' + 'A') : c);
+    }
+    if (!word.empty()) {
+        words.push_back(word);
+    }
+    return words;
+}
+
+std::string buildIndex(std::vector<Entry> entries)
+{
+    std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) {
+        return a.name < b.name || (a.name == b.name && a.code < b.code);
+    });
+    entries.erase(std::unique(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) {
+        return a.name == b.name && a.code == b.code;
+    }), entries.end());
+
+    // the entries of every word, in the order of the entries
+    std::map<std::string, std::vector<uint32_t>> words;
+    for (uint32_t i = 0; i < entries.size(); ++i) {
+        for (const std::string &word : splitWords(entries[i].name)) {
+            std::vector<uint32_t> &postings = words[word];
+            if (postings.empty() || postings.back() != i) {
+                postings.push_back(i);
+            }
+        }
+    }
+
+    std::string strings;
+    std::vector<uint32_t> nameOffsets;
+    nameOffsets.reserve(entries.size());
+    for (const Entry &entry : entries) {
+        nameOffsets.push_back(uint32_t(strings.size()));
+        strings.append(entry.name);
+        strings.push_back('\0');
+    }
+
+    uint32_t postingCount = 0;
+    for (const auto &word : words) {
+        postingCount += uint32_t(word.second.size());
+    }
+
+    std::string index(magic, sizeof(magic));
+    writeNumber(&index, formatVersion);
+    writeNumber(&index, uint32_t(entries.size()));
+    writeNumber(&index, uint32_t(words.size()));
+    writeNumber(&index, postingCount);
+    std::string wordStrings;
+    for (const auto &word : words) {
+        wordStrings.append(word.first);
+        wordStrings.push_back('\0');
+    }
+    writeNumber(&index, uint32_t(strings.size() + wordStrings.size()));
+
+    for (uint32_t i = 0; i < entries.size(); ++i) {
+        writeNumber(&index, entries[i].code);
+        writeNumber(&index, nameOffsets[i]);
+    }
+
+    uint32_t wordOffset = uint32_t(strings.size());
+    uint32_t posting = 0;
+    for (const auto &word : words) {
+        writeNumber(&index, wordOffset);
+        writeNumber(&index, posting);
+        wordOffset += uint32_t(word.first.size() + 1);
+        posting += uint32_t(word.second.size());
+    }
+
+    for (const auto &word : words) {
+        for (uint32_t entry : word.second) {
+            writeNumber(&index, entry);
+        }
+    }
+
+    index.append(strings);
+    index.append(wordStrings);
+    return index;
+}
+
+bool IndexView::open(const char *data, size_t size)
+{
+    *this = IndexView();
+
+    if (size < headerSize || std::memcmp(data, magic, sizeof(magic)) != 0
+        || readNumber(data + 8) != formatVersion) {
+        return false;
+    }
+
+    const uint32_t entryCount = readNumber(data + 12);
+    const uint32_t wordCount = readNumber(data + 16);
+    const uint32_t postingCount = readNumber(data + 20);
+    const uint32_t stringSize = readNumber(data + 24);
+    const uint64_t expected = headerSize + uint64_t(entryCount) * entrySize + uint64_t(wordCount) * wordSize
+        + uint64_t(postingCount) * postingSize + stringSize;
+    if (expected != size || (stringSize > 0 && data[size - 1] != '\0')) {
+        return false;
+    }
+
+    m_entries = data + headerSize;
+    m_words = m_entries + size_t(entryCount) * entrySize;
+    m_postings = m_words + size_t(wordCount) * wordSize;
+    m_strings = m_postings + size_t(postingCount) * postingSize;
+    m_entryCount = entryCount;
+    m_wordCount = wordCount;
+    m_postingCount = postingCount;
+
+    // a broken file must not make the search read outside of it
+    bool valid = true;
+    for (uint32_t i = 0; i < entryCount && valid; ++i) {
+        valid = readNumber(m_entries + i * entrySize + 4) < stringSize;
+    }
+    uint32_t previous = 0;
+    for (uint32_t i = 0; i < wordCount && valid; ++i) {
+        const uint32_t first = firstPosting(i);
+        valid = readNumber(m_words + i * wordSize) < stringSize && first >= previous && first <= postingCount;
+        previous = first;
+    }
+    for (uint32_t i = 0; i < postingCount && valid; ++i) {
+        valid = posting(i) < entryCount;
+    }
+
+    if (!valid) {
+        *this = IndexView();
+        return false;
+    }
+    m_data = data;
+    return true;
+}
+
+bool IndexView::isEmpty() const
+{
+    return m_entryCount == 0;
+}
+
+uint32_t IndexView::entryCode(uint32_t entry) const
+{
+    return readNumber(m_entries + entry * entrySize);
+}
+
+const char *IndexView::entryName(uint32_t entry) const
+{
+    return m_strings + readNumber(m_entries + entry * entrySize + 4);
+}
+
+const char *IndexView::word(uint32_t word) const
+{
+    return m_strings + readNumber(m_words + word * wordSize);
+}
+
+uint32_t IndexView::firstPosting(uint32_t word) const
+{
+    return word < m_wordCount ? readNumber(m_words + word * wordSize + 4) : m_postingCount;
+}
+
+uint32_t IndexView::posting(uint32_t index) const
+{
+    return readNumber(m_postings + index * postingSize);
+}
+
+void IndexView::search(const std::vector<std::string> &words, std::vector<Match> *matches) const
+{
+    if (!m_data || words.empty()) {
+        return;
+    }
+
+    struct Term {
+        const std::string *text;
+        bool typos;
+        // the words of the index the term matches
+        std::vector<uint32_t> words;
+        size_t postings;
+    };
+
+    std::vector<Term> terms;
+    bool typos = false;
+    for (const std::string &text : words) {
+        Term term { &text, false, {}, 0 };
+
+        // the words starting with the term are next to each other
+        uint32_t low = 0;
+        uint32_t high = m_wordCount;
+        while (low < high) {
+            const uint32_t middle = low + (high - low) / 2;
+            if (std::strcmp(word(middle), text.c_str()) < 0) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        for (uint32_t i = low; i < m_wordCount && startsWith(word(i), std::strlen(word(i)), text); ++i) {
+            term.words.push_back(i);
+        }
+
+        if (term.words.empty() && text.size() >= minTypoLength) {
+            term.typos = true;
+            for (uint32_t i = 0; i < m_wordCount; ++i) {
+                if (startsWithTypo(word(i), std::strlen(word(i)), text)) {
+                    term.words.push_back(i);
+                }
+            }
+        }
+        if (term.words.empty()) {
+            return;
+        }
+
+        for (uint32_t i : term.words) {
+            term.postings += firstPosting(i + 1) - firstPosting(i);
+        }
+        typos = typos || term.typos;
+        terms.push_back(std::move(term));
+    }
+
+    // start with the entries of the rarest term and check the others on their names
+    const auto rarest = std::min_element(terms.begin(), terms.end(), [](const Term &a, const Term &b) {
+        return a.postings < b.postings;
+    });
+    std::vector<uint32_t> candidates;
+    candidates.reserve(rarest->postings);
+    for (uint32_t i : rarest->words) {
+        for (uint32_t p = firstPosting(i); p < firstPosting(i + 1); ++p) {
+            candidates.push_back(posting(p));
+        }
+    }
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    std::string phrase;
+    for (const std::string &text : words) {
+        phrase.append(phrase.empty() ? "" : " ").append(text);
+    }
+
+    for (uint32_t entry : candidates) {
+        const char *name = entryName(entry);
+        bool found = true;
+        for (auto term = terms.cbegin(); term != terms.cend() && found; ++term) {
+            found = term == rarest || hasWord(name, *term->text, term->typos);
+        }
+        if (!found) {
+            continue;
+        }
+
+        int score = typos ? 3 : 2;
+        if (std::strcmp(name, phrase.c_str()) == 0) {
+            score = 0;
+        } else if (!typos && std::strncmp(name, phrase.c_str(), phrase.size()) == 0) {
+            score = 1;
+        }
+        matches->push_back({ entryCode(entry), name, score });
+    }
+}
+
+}
@@ -0,0 +1,103 @@
+/* Copyright 2020  Plasma Addons authors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) version 3, or any
+ * later version accepted by the membership of KDE e.V. (or its
+ * successor approved by the membership of KDE e.V.), which shall
+ * act as a proxy defined in Section 6 of version 3 of the license.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CHARNAMES_H
+#define CHARNAMES_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * A searchable index of character names.
+ *
+ * The index of the Unicode names is generated from the Unicode Character
+ * Database at build time and mapped into memory by the runner; the aliases
+ * of the user are put into an index of the same kind when they are read.
+ * This code does not depend on Qt, so the generator does not either.
+ *
+ * The index consists of a header, the entries sorted by name, the words
+ * of all names sorted, the entries containing each word and the names and
+ * words themselves. All numbers are 32 bit little endian.
+ */
+namespace CharNames
+{
+
+struct Entry {
+    std::string name;
+    uint32_t code;
+};
+
+/**
+ * Returns the words of @p text in upper case, split at blanks and hyphens.
+ */
+std::vector<std::string> splitWords(const std::string &text);
+
+/**
+ * Returns the index of @p entries, whose names must be in upper case.
+ */
+std::string buildIndex(std::vector<Entry> entries);
+
+class IndexView
+{
+public:
+    struct Match {
+        uint32_t code;
+        const char *name;
+        // 0 for the exact name, 1 for names starting with the query,
+        // 2 for names containing all words and 3 for those with typos
+        int score;
+    };
+
+    /**
+     * Checks the index at @p data; returns false if it is not valid,
+     * the view stays empty then.
+     */
+    bool open(const char *data, size_t size);
+
+    bool isEmpty() const;
+
+    /**
+     * Appends all entries to @p matches with a word starting with each of
+     * @p words, as returned by splitWords(). Words of four or more letters
+     * which start no word at all may contain one typo.
+     */
+    void search(const std::vector<std::string> &words, std::vector<Match> *matches) const;
+
+private:
+    uint32_t entryCode(uint32_t entry) const;
+    const char *entryName(uint32_t entry) const;
+    const char *word(uint32_t word) const;
+    uint32_t firstPosting(uint32_t word) const;
+    uint32_t posting(uint32_t index) const;
+
+    const char *m_data = nullptr;
+    uint32_t m_entryCount = 0;
+    uint32_t m_wordCount = 0;
+    uint32_t m_postingCount = 0;
+    const char *m_entries = nullptr;
+    const char *m_words = nullptr;
+    const char *m_postings = nullptr;
+    const char *m_strings = nullptr;
+};
+
+}
+
+#endif
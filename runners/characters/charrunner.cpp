@@ -23,12 +23,21 @@
 #include <KRunner/QueryMatch>
 #include <KLocalizedString>
 
+// Qt
+#include <QDebug>
+#include <QStandardPaths>
+
+#include <algorithm>
+
 
 //Names of config-entries
 static const char CONFIG_TRIGGERWORD[] = "triggerWord";
 static const char CONFIG_ALIASES[] = "aliases";
 static const char CONFIG_CODES[] = "codes";
 
+//most words start many names, nobody looks through all of them
+static const size_t MAX_NAME_MATCHES = 10;
+
 
 CharacterRunner::CharacterRunner( QObject* parent, const QVariantList &args )
     : Plasma::AbstractRunner(parent, args)
@@ -38,6 +47,7 @@ CharacterRunner::CharacterRunner( QObject* parent, const QVariantList &args )
     setIgnoredTypes(Plasma::RunnerContext::Directory | Plasma::RunnerContext::File |
                          Plasma::RunnerContext::NetworkLocation | Plasma::RunnerContext::Executable |
                          Plasma::RunnerContext::ShellCommand);
+    loadNames();
     reloadConfiguration();
 }
 
@@ -45,15 +55,59 @@ CharacterRunner::~CharacterRunner()
 {
 }
 
+void CharacterRunner::loadNames()
+{
+  const QString path = QStandardPaths::locate(QStandardPaths::GenericDataLocation,
+                                              QStringLiteral("krunner_charrunner/charnames.idx"));
+  if (path.isEmpty()) //built without the Unicode Character Database
+  {
+    return;
+  }
+
+  m_namesFile.setFileName(path);
+  if (!m_namesFile.open(QIODevice::ReadOnly))
+  {
+    return;
+  }
+  //mapped rather than read, only the pages a search touches are loaded
+  const uchar *data = m_namesFile.map(0, m_namesFile.size());
+  if (!data || !m_names.open(reinterpret_cast<const char *>(data), size_t(m_namesFile.size())))
+  {
+    qWarning() << "Invalid character name index" << path;
+  }
+}
+
 void CharacterRunner::reloadConfiguration()
 {
   KConfigGroup grp = config(); //Create config-object
 
   m_triggerWord = grp.readEntry(CONFIG_TRIGGERWORD, "#"); //read out the triggerword
-  m_aliases = grp.readEntry(CONFIG_ALIASES, QStringList());
-  m_codes = grp.readEntry(CONFIG_CODES, QStringList());
+  const QStringList aliases = grp.readEntry(CONFIG_ALIASES, QStringList());
+  const QStringList codes = grp.readEntry(CONFIG_CODES, QStringList());
+
+  //put the aliases into an index of the same kind as the one of the Unicode names
+  std::vector<CharNames::Entry> entries;
+  QHash<QString, uint> aliasCodes;
+  for (int i = 0; i < aliases.count() && i < codes.count(); ++i)
+  {
+    bool ok;
+    const uint code = codes[i].toUInt(&ok, 16);
+    if (ok)
+    {
+      entries.push_back({ aliases[i].toUpper().toStdString(), code });
+      //the query is compared without its blanks
+      aliasCodes.insert(QString(aliases[i]).remove(QLatin1Char(' ')), code);
+    }
+  }
+  {
+    QWriteLocker locker(&m_aliasLock);
+    m_aliasCodes = aliasCodes;
+    m_aliasData = CharNames::buildIndex(entries);
+    m_aliases.open(m_aliasData.data(), m_aliasData.size());
+  }
+
   addSyntax(Plasma::RunnerSyntax(m_triggerWord + QLatin1String( ":q:" ),
-                                 i18n("Creates Characters from :q: if it is a hexadecimal code or defined alias.")));
+                                 i18n("Creates Characters from :q: if it is a hexadecimal code, a defined alias or a part of the name of a character.")));
 }
 
 void CharacterRunner::match(Plasma::RunnerContext &context)
@@ -71,29 +125,94 @@ void CharacterRunner::match(Plasma::RunnerContext &context)
     }
     term = term.remove(0, m_triggerWord.length()); //remove the triggerword
 
-    if (m_aliases.contains(term)) //replace aliases by their hex.-code
+    //the names are searched with the blanks, they separate the words
+    const QString name = context.query().trimmed().mid(m_triggerWord.length());
+    const std::vector<std::string> words = CharNames::splitWords(name.toUpper().toStdString());
+
+    struct Found {
+      uint code;
+      QString name;
+      int score;
+    };
+    std::vector<Found> found;
+    bool isAlias = false;
     {
-      term = m_codes[m_aliases.indexOf(term)];
+      QReadLocker locker(&m_aliasLock);
+      //an alias typed exactly like that comes before everything else
+      const auto exact = m_aliasCodes.constFind(term);
+      if (exact != m_aliasCodes.constEnd())
+      {
+        isAlias = true;
+        found.push_back({ exact.value(), exact.key(), -1 });
+      }
+
+      std::vector<CharNames::IndexView::Match> matches;
+      m_aliases.search(words, &matches);
+      for (const CharNames::IndexView::Match &match : matches)
+      {
+        if (exact != m_aliasCodes.constEnd() && match.code == exact.value())
+        {
+          continue;
+        }
+        isAlias = isAlias || match.score == 0;
+        found.push_back({ match.code, QString::fromUtf8(match.name), match.score });
+      }
     }
 
+    //an alias is preferred to reading the query as a hex.-code, as always
     bool ok; //checkvariable
-    int hex = term.toInt(&ok, 16); //convert query into int
-    if (!ok) //check if conversion was successful
+    const uint hex = term.toUInt(&ok, 16); //convert query into int
+    if (ok && !isAlias && hex <= 0x10FFFF) //check if conversion was successful
     {
-      return;
+      //make special character out of the hex.-code
+      const QString specChar = QString::fromUcs4(&hex, 1);
+
+      //create match
+      Plasma::QueryMatch match(this);
+      match.setType(Plasma::QueryMatch::InformationalMatch);
+      match.setIconName(QStringLiteral("accessories-character-map"));
+      match.setText(specChar);
+      match.setData(specChar);
+      match.setId(QString());
+      context.addMatch(match);
     }
 
-    //make special character out of the hex.-code
-    const QString specChar = QChar(hex);
-
-    //create match
-    Plasma::QueryMatch match(this);
-    match.setType(Plasma::QueryMatch::InformationalMatch);
-    match.setIconName(QStringLiteral("accessories-character-map"));
-    match.setText(specChar);
-    match.setData(specChar);
-    match.setId(QString());
-    context.addMatch(match);
+    //single letters start too many names to be of any use
+    if (term.length() >= 2)
+    {
+      std::vector<CharNames::IndexView::Match> matches;
+      m_names.search(words, &matches);
+      //the best and shortest names first
+      const size_t count = std::min(matches.size(), MAX_NAME_MATCHES);
+      std::partial_sort(matches.begin(), matches.begin() + count, matches.end(),
+                        [](const CharNames::IndexView::Match &a, const CharNames::IndexView::Match &b) {
+        return a.score < b.score || (a.score == b.score && qstrlen(a.name) < qstrlen(b.name));
+      });
+      for (size_t i = 0; i < count; ++i)
+      {
+        found.push_back({ matches[i].code, QString::fromLatin1(matches[i].name), matches[i].score });
+      }
+    }
+
+    //the aliases of the user come first among equally good names
+    std::stable_sort(found.begin(), found.end(), [](const Found &a, const Found &b) {
+      return a.score < b.score;
+    });
+    const size_t count = std::min(found.size(), MAX_NAME_MATCHES);
+    for (size_t i = 0; i < count; ++i)
+    {
+      const QString specChar = QString::fromUcs4(&found[i].code, 1);
+
+      Plasma::QueryMatch match(this);
+      match.setType(Plasma::QueryMatch::InformationalMatch);
+      match.setIconName(QStringLiteral("accessories-character-map"));
+      match.setText(specChar);
+      match.setSubtext(found[i].name);
+      match.setData(specChar);
+      match.setId(QString::number(found[i].code, 16));
+      match.setRelevance(found[i].score <= 0 ? 1.0 : 0.9 - i * 0.05);
+      context.addMatch(match);
+    }
 }
 
 K_EXPORT_PLASMA_RUNNER(CharacterRunner, CharacterRunner)
@@ -22,6 +22,14 @@
 
 #include <KRunner/AbstractRunner>
 
+#include <QFile>
+#include <QHash>
+#include <QReadWriteLock>
+
+#include <string>
+
+#include "charnames.h"
+
 class CharacterRunner : public Plasma::AbstractRunner
 {
   Q_OBJECT
@@ -34,10 +42,20 @@ class CharacterRunner : public Plasma::AbstractRunner
     void reloadConfiguration() override;
 	
   private:
+    void loadNames();
+
     //config-variables
     QString m_triggerWord;
-    QList<QString> m_aliases;
-    QList<QString> m_codes;
+
+    //the Unicode names, mapped from the index installed with the runner
+    QFile m_namesFile;
+    CharNames::IndexView m_names;
+    //the aliases of the user as they are typed, which win over everything else
+    QHash<QString, uint> m_aliasCodes;
+    //and in an index of the same kind, to find them by part of their words
+    std::string m_aliasData;
+    CharNames::IndexView m_aliases;
+    QReadWriteLock m_aliasLock;
 };
 
 #endif
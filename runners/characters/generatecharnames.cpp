@@ -0,0 +1,95 @@
+/* Copyright 2020  Plasma Addons authors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) version 3, or any
+ * later version accepted by the membership of KDE e.V. (or its
+ * successor approved by the membership of KDE e.V.), which shall
+ * act as a proxy defined in Section 6 of version 3 of the license.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Generates the index of character names searched by the runner from
+// UnicodeData.txt and, if given, NameAliases.txt of the Unicode Character Database:
+//
+//   generatecharnames UnicodeData.txt [NameAliases.txt] charnames.idx
+
+#include "charnames.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+std::vector<std::string> splitFields(const std::string &line)
+{
+    std::vector<std::string> fields;
+    std::istringstream stream(line);
+    std::string field;
+    while (std::getline(stream, field, ';')) {
+        fields.push_back(field);
+    }
+    return fields;
+}
+
+// reads the entries of a file in which each line starts with a code and a name,
+// returns false if it cannot be read
+bool readEntries(const char *path, std::vector<CharNames::Entry> *entries)
+{
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "cannot read " << path << std::endl;
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        const std::vector<std::string> fields = splitFields(line);
+        // "<control>", "<CJK Ideograph, First>" and the like are no names
+        if (fields.size() < 2 || fields[1].empty() || fields[1][0] == '<') {
+            continue;
+        }
+        const uint32_t code = uint32_t(std::strtoul(fields[0].c_str(), nullptr, 16));
+        entries->push_back({ fields[1], code });
+    }
+    return true;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 3 && argc != 4) {
+        std::cerr << "usage: " << argv[0] << " UnicodeData.txt [NameAliases.txt] output" << std::endl;
+        return 1;
+    }
+
+    std::vector<CharNames::Entry> entries;
+    for (int i = 1; i < argc - 1; ++i) {
+        if (!readEntries(argv[i], &entries)) {
+            return 1;
+        }
+    }
+
+    const std::string index = CharNames::buildIndex(entries);
+    std::ofstream output(argv[argc - 1], std::ios::binary);
+    output.write(index.data(), std::streamsize(index.size()));
+    if (!output) {
+        std::cerr << "cannot write " << argv[argc - 1] << std::endl;
+        return 1;
+    }
+    return 0;
+}
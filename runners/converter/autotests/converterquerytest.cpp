@@ -0,0 +1,239 @@
+/*
+ * Copyright (C) 2020 by the Plasma Addons authors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "queryparser.h"
+#include "unitindex.h"
+
+#include <QLocale>
+#include <QSet>
+#include <QTest>
+
+#include <KUnitConversion/Converter>
+#include <KUnitConversion/UnitCategory>
+
+namespace {
+const QStringList separators = { QString(CONVERSION_CHAR), QStringLiteral("in"), QStringLiteral("to"), QStringLiteral("as") };
+
+// what people type into KRunner, which runs the query again on every key press
+const QStringList queries = {
+    QStringLiteral("3ft 4in to cm"),
+    QStringLiteral("2*1.5 kg in lb"),
+    QStringLiteral("10 km/h > m/s"),
+    QStringLiteral("100 km"),
+    QStringLiteral("-40 °C in °F"),
+    QStringLiteral("1/2 cup to ml"),
+    QStringLiteral("5 mi > km"),
+    QStringLiteral("12 oz in g"),
+    QStringLiteral("3.5 l to gal"),
+    QStringLiteral("60 mph in km/h"),
+    QStringLiteral("1024 KiB to MiB"),
+    QStringLiteral("2 kilometers to mi"),
+    QStringLiteral("1000 m to kilo"),
+};
+}
+
+class ConverterQueryTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+
+    void parse_data();
+    void parse();
+    void parseInvalid_data();
+    void parseInvalid();
+    void find_data();
+    void find();
+    void findPrefix();
+    void queryStream();
+    void benchmarkQueryStream();
+
+private:
+    // looks up every unit of the query the way ConverterRunner::match() does,
+    // returns whether it could be converted
+    bool resolve(const QString &query) const;
+
+    KUnitConversion::Converter m_converter;
+    UnitIndex m_units;
+};
+
+void ConverterQueryTest::initTestCase()
+{
+    QLocale::setDefault(QLocale::c());
+    m_units.build(m_converter);
+    QVERIFY(!m_units.isEmpty());
+}
+
+void ConverterQueryTest::parse_data()
+{
+    QTest::addColumn<QString>("query");
+    QTest::addColumn<QList<double>>("numbers");
+    QTest::addColumn<QStringList>("units");
+    QTest::addColumn<QString>("target");
+
+    QTest::newRow("sum") << QStringLiteral("3ft 4in to cm") << QList<double>{ 3, 4 } << QStringList{ QStringLiteral("ft"), QStringLiteral("in") } << QStringLiteral("cm");
+    QTest::newRow("product") << QStringLiteral("2*1.5 kg in lb") << QList<double>{ 3 } << QStringList{ QStringLiteral("kg") } << QStringLiteral("lb");
+    QTest::newRow("fraction") << QStringLiteral("1/2 cup") << QList<double>{ 0.5 } << QStringList{ QStringLiteral("cup") } << QString();
+    QTest::newRow("unit with a slash") << QStringLiteral("10 km/h > m/s") << QList<double>{ 10 } << QStringList{ QStringLiteral("km/h") } << QStringLiteral("m/s");
+    QTest::newRow("unit first") << QStringLiteral("$ 5") << QList<double>{ 5 } << QStringList{ QStringLiteral("$") } << QString();
+    QTest::newRow("two words") << QStringLiteral("5 light year in km") << QList<double>{ 5 } << QStringList{ QStringLiteral("light year") } << QStringLiteral("km");
+    QTest::newRow("negative") << QStringLiteral("-3.5 °C>°F") << QList<double>{ -3.5 } << QStringList{ QStringLiteral("°C") } << QStringLiteral("°F");
+    QTest::newRow("no target yet") << QStringLiteral("12 m to") << QList<double>{ 12 } << QStringList{ QStringLiteral("m") } << QString();
+    QTest::newRow("separator in the target") << QStringLiteral("12 m to inch") << QList<double>{ 12 } << QStringList{ QStringLiteral("m") } << QStringLiteral("inch");
+}
+
+void ConverterQueryTest::parse()
+{
+    QFETCH(QString, query);
+    QFETCH(QList<double>, numbers);
+    QFETCH(QStringList, units);
+    QFETCH(QString, target);
+
+    const QueryParser parser(query, separators);
+    QVERIFY(parser.isValid());
+    const QVector<QueryParser::Term> terms = parser.terms();
+    QCOMPARE(terms.count(), numbers.count());
+    for (int i = 0; i < terms.count(); ++i) {
+        QCOMPARE(terms.at(i).number, numbers.at(i));
+        QCOMPARE(terms.at(i).unit, units.at(i));
+    }
+    QCOMPARE(parser.target(), target);
+}
+
+void ConverterQueryTest::parseInvalid_data()
+{
+    QTest::addColumn<QString>("query");
+
+    QTest::newRow("word") << QStringLiteral("hello");
+    QTest::newRow("number only") << QStringLiteral("5");
+    QTest::newRow("division by zero") << QStringLiteral("1/0 m");
+    QTest::newRow("separator only") << QStringLiteral("to cm");
+}
+
+void ConverterQueryTest::parseInvalid()
+{
+    QFETCH(QString, query);
+
+    QVERIFY(!QueryParser(query, separators).isValid());
+}
+
+void ConverterQueryTest::find_data()
+{
+    QTest::addColumn<QString>("name");
+    QTest::addColumn<int>("category");
+    QTest::addColumn<int>("unit");
+
+    QTest::newRow("symbol") << QStringLiteral("km") << int(KUnitConversion::LengthCategory) << int(KUnitConversion::Kilometer);
+    QTest::newRow("upper case") << QStringLiteral("KM") << int(KUnitConversion::LengthCategory) << int(KUnitConversion::Kilometer);
+    QTest::newRow("plural") << QStringLiteral("kilometers") << int(KUnitConversion::LengthCategory) << int(KUnitConversion::Kilometer);
+    QTest::newRow("mass") << QStringLiteral("lb") << int(KUnitConversion::MassCategory) << int(KUnitConversion::Pound);
+    QTest::newRow("not ascii") << QStringLiteral("°C") << int(KUnitConversion::TemperatureCategory) << int(KUnitConversion::Celsius);
+}
+
+void ConverterQueryTest::find()
+{
+    QFETCH(QString, name);
+    QFETCH(int, category);
+    QFETCH(int, unit);
+
+    const QVector<UnitIndex::Entry> entries = m_units.find(name);
+    QVERIFY(!entries.isEmpty());
+    bool found = false;
+    for (const UnitIndex::Entry &entry : entries) {
+        QCOMPARE(entry.name.toCaseFolded(), name.toCaseFolded());
+        QCOMPARE(m_converter.category(entry.category).unit(entry.name).id(), entry.unit);
+        found = found || (entry.category == category && entry.unit == unit);
+    }
+    QVERIFY(found);
+
+    QVERIFY(m_units.find(name.left(name.size() - 1) + QLatin1Char('#')).isEmpty());
+}
+
+void ConverterQueryTest::findPrefix()
+{
+    const QVector<UnitIndex::Entry> entries = m_units.findPrefix(QStringLiteral("Kilo"), KUnitConversion::MassCategory);
+
+    QSet<int> units;
+    for (const UnitIndex::Entry &entry : entries) {
+        QCOMPARE(entry.category, KUnitConversion::MassCategory);
+        QVERIFY(entry.name.startsWith(QLatin1String("kilo"), Qt::CaseInsensitive));
+        QVERIFY2(!units.contains(entry.unit), qPrintable(entry.name));
+        units.insert(entry.unit);
+    }
+    QVERIFY(units.contains(KUnitConversion::Kilogram));
+    QVERIFY(!units.contains(KUnitConversion::Kilometer));
+
+    QVERIFY(m_units.findPrefix(QStringLiteral("kilo"), KUnitConversion::TemperatureCategory).isEmpty());
+}
+
+bool ConverterQueryTest::resolve(const QString &query) const
+{
+    const QueryParser parser(query, separators);
+    if (!parser.isValid()) {
+        return false;
+    }
+
+    const QVector<QueryParser::Term> terms = parser.terms();
+    const QVector<UnitIndex::Entry> first = m_units.find(terms.first().unit);
+    if (first.isEmpty()) {
+        return false;
+    }
+    const KUnitConversion::CategoryId category = first.first().category;
+    for (int i = 1; i < terms.count(); ++i) {
+        if (m_units.find(terms.at(i).unit).isEmpty()) {
+            return false;
+        }
+    }
+
+    const QString target = parser.target();
+    return target.isEmpty() || !m_units.find(target).isEmpty() || !m_units.findPrefix(target, category).isEmpty();
+}
+
+void ConverterQueryTest::queryStream()
+{
+    for (const QString &query : queries) {
+        QVERIFY2(resolve(query), qPrintable(query));
+    }
+
+    // half typed units which are not the beginning of any unit
+    QVERIFY(!resolve(QStringLiteral("3 fx")));
+    QVERIFY(!resolve(QStringLiteral("5 km to xq")));
+}
+
+void ConverterQueryTest::benchmarkQueryStream()
+{
+    QStringList keyPresses;
+    for (const QString &query : queries) {
+        for (int i = 1; i <= query.size(); ++i) {
+            keyPresses << query.left(i);
+        }
+    }
+
+    int resolved = 0;
+    QBENCHMARK {
+        resolved = 0;
+        for (const QString &query : qAsConst(keyPresses)) {
+            resolved += resolve(query);
+        }
+    }
+    QVERIFY(resolved >= queries.count());
+}
+
+QTEST_GUILESS_MAIN(ConverterQueryTest)
+
+#include "converterquerytest.moc"
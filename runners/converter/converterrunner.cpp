@@ -16,10 +16,13 @@
  */
 
 #include "converterrunner.h"
+#include "queryparser.h"
 #include <QGuiApplication>
 #include <QClipboard>
 #include <QDesktopServices>
+#include <QLocale>
 #include <QSet>
+#include <QVector>
 #include <QDebug>
 #include <KLocalizedString>
 #include <KUnitConversion/Converter>
@@ -27,103 +30,11 @@
 
 #include <cmath>
 
-#define CONVERSION_CHAR QLatin1Char( '>' )
-
 K_EXPORT_PLASMA_RUNNER(converterrunner, ConverterRunner)
 
-class StringParser
-{
-public:
-    enum GetType
-    {
-        GetString = 1,
-        GetDigit  = 2
-    };
-
-    StringParser(const QString &s) : m_index(0), m_s(s) {}
-    ~StringParser() {}
-
-    QString get(int type)
-    {
-        QChar current;
-        QString result;
-
-        passWhiteSpace();
-        while (true) {
-            current = next();
-            if (current.isNull()) {
-                break;
-            }
-            if (current.isSpace()) {
-                break;
-            }
-            bool number = isNumber(current);
-            if (type == GetDigit && !number) {
-                break;
-            }
-            if (type == GetString && number) {
-                break;
-            }
-            if(current == QLatin1Char( CONVERSION_CHAR )) {
-                break;
-            }
-            ++m_index;
-            result += current;
-        }
-        return result;
-    }
-
-    bool isNumber(const QChar &ch)
-    {
-        if (ch.isNumber()) {
-            return true;
-        }
-        if (QStringLiteral(".,-+/").contains(ch)) {
-            return true;
-        }
-        return false;
-    }
-
-    QString rest()
-    {
-        return m_s.mid(m_index).simplified();
-    }
-
-    void pass(const QStringList &strings)
-    {
-        passWhiteSpace();
-        const QString temp = m_s.mid(m_index);
-
-        foreach (const QString& s, strings) {
-            if (temp.startsWith(s)) {
-                m_index += s.length();
-                return;
-            }
-        }
-    }
-
-private:
-    void passWhiteSpace()
-    {
-        while (next().isSpace()) {
-            ++m_index;
-        }
-    }
-
-    QChar next()
-    {
-        if (m_index >= m_s.size()) {
-            return QChar::Null;
-        }
-        return m_s.at(m_index);
-    }
-
-    int m_index;
-    QString m_s;
-};
-
 ConverterRunner::ConverterRunner(QObject* parent, const QVariantList &args)
-    : Plasma::AbstractRunner(parent, args)
+    : Plasma::AbstractRunner(parent, args),
+      m_rates(new CurrencyRates(this))
 {
     Q_UNUSED(args)
     setObjectName(QLatin1String( "Converter" ));
@@ -137,15 +48,28 @@ ConverterRunner::ConverterRunner(QObject* parent, const QVariantList &args)
                     Plasma::RunnerContext::NetworkLocation);
 
     QString description = i18n("Converts the value of :q: when :q: is made up of "
-                               "\"value unit [>, to, as, in] unit\". You can use the "
+                               "\"value unit [>, to, as, in] unit\". The value may be a "
+                               "product like \"2*1.5\" or a fraction, and several values "
+                               "are added up, as in \"3ft 4in to cm\". You can use the "
                                "Unit converter applet to find all available units.");
     addSyntax(Plasma::RunnerSyntax(QLatin1String(":q:"), description));
+
+    connect(this, &Plasma::AbstractRunner::prepare, this, &ConverterRunner::buildIndex);
+    connect(this, &Plasma::AbstractRunner::prepare, m_rates, &CurrencyRates::prepare);
 }
 
 ConverterRunner::~ConverterRunner()
 {
 }
 
+void ConverterRunner::buildIndex()
+{
+    QMutexLocker locker(&m_unitsMutex);
+    if (m_units.isEmpty()) {
+        m_units.build(m_converter);
+    }
+}
+
 void ConverterRunner::match(Plasma::RunnerContext &context)
 {
     const QString term = context.query();
@@ -153,52 +77,67 @@ void ConverterRunner::match(Plasma::RunnerContext &context)
         return;
     }
 
-    StringParser cmd(term);
-    QString unit1;
-    QString value;
-    QString unit2;
-
-    unit1 = cmd.get(StringParser::GetString);
-    value = cmd.get(StringParser::GetDigit);
-    if (value.isEmpty()) {
+    // parsed and evaluated only once, whatever the number of units to convert to
+    const QueryParser query(term, m_separators);
+    if (!query.isValid()) {
         return;
     }
-    if (unit1.isEmpty()) {
-        unit1 = cmd.get(StringParser::GetString | StringParser::GetDigit);
-        if (unit1.isEmpty()) {
-            return;
+    const QVector<QueryParser::Term> terms = query.terms();
+    const QString unit2 = query.target();
+
+    // in case the query did not come with a prepare()
+    buildIndex();
+
+    // a unit spelled exactly like that wins, otherwise the first one ignoring case,
+    // preferably in the category of the first term
+    auto resolve = [this](const QString &name, KUnitConversion::CategoryId category, UnitIndex::Entry *entry) {
+        const QVector<UnitIndex::Entry> candidates = m_units.find(name);
+        if (candidates.isEmpty()) {
+            return false;
+        }
+        *entry = candidates.first();
+        int best = 3;
+        for (const UnitIndex::Entry &candidate : candidates) {
+            const int rank = (candidate.name == name ? 0 : 1) + (category == KUnitConversion::InvalidCategory || candidate.category == category ? 0 : 2);
+            if (rank < best) {
+                *entry = candidate;
+                best = rank;
+            }
         }
-    }
-
-    const QString s = cmd.get(StringParser::GetString);
+        return true;
+    };
 
-    if (!s.isEmpty() && !m_separators.contains(s)) {
-        unit1 += QLatin1Char( ' ' ) + s;
+    UnitIndex::Entry entry;
+    if (!resolve(terms.first().unit, KUnitConversion::InvalidCategory, &entry)) {
+        return;
     }
-    if (s.isEmpty() || !m_separators.contains(s)) {
-        cmd.pass(m_separators);
+    const KUnitConversion::UnitCategory category = m_converter.category(entry.category);
+    const KUnitConversion::Unit u1 = category.unit(entry.name);
+
+    // KUnitConversion would download new exchange rates right here if they are a day old,
+    // so currencies are converted with the ones read at the start of the session
+    QSharedPointer<const CurrencyRates::Snapshot> rates;
+    if (category.id() == KUnitConversion::CurrencyCategory) {
+        rates = m_rates->snapshot();
+        if (!rates) {
+            return;
+        }
     }
-    unit2 = cmd.rest();
+    auto convert = [&category, &rates](const KUnitConversion::Value &value, const KUnitConversion::Unit &unit) {
+        return rates ? rates->convert(value, unit) : category.convert(value, unit);
+    };
 
-    KUnitConversion::Converter converter;
-    KUnitConversion::UnitCategory category = converter.categoryForUnit(unit1);
-    bool found = false;
-    if (category.id() == KUnitConversion::InvalidCategory) {
-        foreach (category, converter.categories()) {
-            foreach (const QString& s, category.allUnits()) {
-                if (s.compare(unit1, Qt::CaseInsensitive) == 0) {
-                    unit1 = s;
-                    found = true;
-                    break;
-                }
-            }
-            if (found) {
-                break;
-            }
+    // "3ft 4in" is added up in the unit of the first term
+    double numberValue = terms.first().number;
+    for (int i = 1; i < terms.count(); ++i) {
+        if (!resolve(terms.at(i).unit, category.id(), &entry) || entry.category != category.id()) {
+            return;
         }
-        if (!found) {
+        const KUnitConversion::Value v = convert(KUnitConversion::Value(terms.at(i).number, category.unit(entry.name)), u1);
+        if (!v.isValid()) {
             return;
         }
+        numberValue += v.number();
     }
 
     QList<KUnitConversion::Unit> units;
@@ -209,17 +148,10 @@ void ConverterRunner::match(Plasma::RunnerContext &context)
             units.append(u);
             config().writeEntry(category.name(), u.symbol());
         } else {
-            const QStringList unitStrings = category.allUnits();
-            QList<KUnitConversion::Unit> matchingUnits;
-            foreach (const QString& s, unitStrings) {
-                if (s.startsWith(unit2, Qt::CaseInsensitive)) {
-                    u = category.unit(s);
-                    if (!matchingUnits.contains(u)) {
-                        matchingUnits << u;
-                    }
-                }
+            const QVector<UnitIndex::Entry> matchingUnits = m_units.findPrefix(unit2, category.id());
+            for (const UnitIndex::Entry &matchingUnit : matchingUnits) {
+                units << category.unit(matchingUnit.name);
             }
-            units = matchingUnits;
             if (units.count() == 1) {
                 config().writeEntry(category.name(), units[0].symbol());
             }
@@ -244,49 +176,14 @@ void ConverterRunner::match(Plasma::RunnerContext &context)
 
     QList<Plasma::QueryMatch> matches;
 
-    QLocale locale;
-    auto stringToDouble = [&locale](const QStringRef &value, bool *ok) {
-        double numberValue = locale.toDouble(value, ok);
-        if (!(*ok)) {
-            numberValue = value.toDouble(ok);
-        }
-        return numberValue;
-    };
-
-    KUnitConversion::Unit u1 = category.unit(unit1);
-    foreach (const KUnitConversion::Unit& u, units) {
-        if (u1 == u) {
-            continue;
-        }
-
-        double numberValue = 0.0;
-
-        const auto fractionParts = value.splitRef(QLatin1Char('/'), QString::SkipEmptyParts);
-        if (fractionParts.isEmpty() || fractionParts.count() > 2) {
+    const KUnitConversion::Value value(numberValue, u1);
+    for (const KUnitConversion::Unit &u : qAsConst(units)) {
+        // a sum of several terms is worth converting to the unit of the first one
+        if (u1 == u && terms.count() == 1) {
             continue;
         }
 
-        if (fractionParts.count() == 2) {
-            bool ok;
-            const double numerator = stringToDouble(fractionParts.first(), &ok);
-            if (!ok) {
-                continue;
-            }
-            const double denominator = stringToDouble(fractionParts.last(), &ok);
-            if (!ok || qFuzzyIsNull(denominator)) {
-                continue;
-            }
-
-            numberValue = numerator / denominator;
-        } else if (fractionParts.count() == 1) {
-            bool ok;
-            numberValue = stringToDouble(fractionParts.first(), &ok);
-            if (!ok) {
-                continue;
-            }
-        }
-
-        KUnitConversion::Value v = category.convert(KUnitConversion::Value(numberValue, u1), u);
+        const KUnitConversion::Value v = convert(value, u);
 
         if (!v.isValid()) {
             continue;
@@ -296,6 +193,10 @@ void ConverterRunner::match(Plasma::RunnerContext &context)
         match.setType(Plasma::QueryMatch::InformationalMatch);
         match.setIconName(QStringLiteral("edit-copy"));
         match.setText(QStringLiteral("%1 (%2)").arg(v.toString(), u.symbol()));
+        if (rates && rates->isStale()) {
+            match.setSubtext(i18n("Exchange rate of %1, newer rates could not be downloaded",
+                                  QLocale().toString(rates->date, QLocale::ShortFormat)));
+        }
         match.setData(v.number());
         match.setRelevance(1.0 - std::abs(std::log10(v.number())) / 50.0);
         matches.append(match);
@@ -20,6 +20,13 @@
 
 #include <krunner/abstractrunner.h>
 
+#include <QMutex>
+
+#include <KUnitConversion/Converter>
+
+#include "currencyrates.h"
+#include "unitindex.h"
+
 /**
  * This class converts values to different units.
  */
@@ -34,8 +41,16 @@ public:
     void match(Plasma::RunnerContext &context) override;
     void run(const Plasma::RunnerContext &context, const Plasma::QueryMatch &match) override;
 
+private Q_SLOTS:
+    void buildIndex();
+
 private:
     QStringList m_separators;
+    KUnitConversion::Converter m_converter;
+    // built on the first query session, the units do not change afterwards
+    UnitIndex m_units;
+    QMutex m_unitsMutex;
+    CurrencyRates *m_rates;
 };
 
 #endif
@@ -0,0 +1,214 @@
+/*
+ * Copyright (C) 2020 by the Plasma Addons authors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "currencyrates.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QUrl>
+#include <QXmlStreamReader>
+
+#include <KIO/StoredTransferJob>
+#include <KUnitConversion/Unit>
+
+namespace {
+
+const QLatin1String ratesUrl("https://www.ecb.europa.eu/stats/eurofxref/eurofxref-daily.xml");
+
+// the same as KUnitConversion, which reads the downloaded rates as well
+const int updateInterval = 24 * 60 * 60;
+// when offline, do not try again on every query session
+const int retryInterval = 15 * 60;
+
+// the rates are published on working days only
+const int staleDays = 4;
+
+// the currencies replaced by the euro, which KUnitConversion converts with the
+// rates fixed when they were replaced; they are not in the file of the bank
+const struct {
+    const char *code;
+    double rate;
+} legacyRates[] = {
+    { "ATS", 13.7603 },
+    { "BEF", 40.3399 },
+    { "CYP", 0.585274 },
+    { "DEM", 1.95583 },
+    { "EEK", 15.6466 },
+    { "ESP", 166.386 },
+    { "FIM", 5.94573 },
+    { "FRF", 6.55957 },
+    { "GRD", 340.750 },
+    { "IEP", 0.787564 },
+    { "ITL", 1936.27 },
+    { "LTL", 3.45280 },
+    { "LUF", 40.3399 },
+    { "LVL", 0.702804 },
+    { "MTL", 0.429300 },
+    { "NLG", 2.20371 },
+    { "PTE", 200.482 },
+    { "SIT", 239.640 },
+    { "SKK", 30.1260 },
+};
+
+QSharedPointer<CurrencyRates::Snapshot> parse(const QByteArray &data)
+{
+    QSharedPointer<CurrencyRates::Snapshot> snapshot(new CurrencyRates::Snapshot);
+    snapshot->rates.insert(QStringLiteral("EUR"), 1.0);
+    for (const auto &legacy : legacyRates) {
+        snapshot->rates.insert(QLatin1String(legacy.code), legacy.rate);
+    }
+    const int fixedRates = snapshot->rates.count();
+
+    QXmlStreamReader xml(data);
+    while (!xml.atEnd()) {
+        xml.readNext();
+        if (!xml.isStartElement() || xml.name() != QLatin1String("Cube")) {
+            continue;
+        }
+
+        const QXmlStreamAttributes attributes = xml.attributes();
+        if (attributes.hasAttribute(QLatin1String("time"))) {
+            snapshot->date = QDate::fromString(attributes.value(QLatin1String("time")).toString(), Qt::ISODate);
+        } else if (attributes.hasAttribute(QLatin1String("currency"))) {
+            bool ok;
+            const double rate = attributes.value(QLatin1String("rate")).toDouble(&ok);
+            if (ok && rate > 0) {
+                snapshot->rates.insert(attributes.value(QLatin1String("currency")).toString(), rate);
+            }
+        }
+    }
+
+    if (xml.hasError() || snapshot->rates.count() == fixedRates) {
+        return QSharedPointer<CurrencyRates::Snapshot>();
+    }
+    return snapshot;
+}
+
+}
+
+KUnitConversion::Value CurrencyRates::Snapshot::convert(const KUnitConversion::Value &value, const KUnitConversion::Unit &unit) const
+{
+    const double from = rates.value(value.unit().symbol());
+    const double to = rates.value(unit.symbol());
+    if (from <= 0 || to <= 0) {
+        return KUnitConversion::Value();
+    }
+    return KUnitConversion::Value(value.number() / from * to, unit);
+}
+
+bool CurrencyRates::Snapshot::isStale() const
+{
+    return !date.isValid() || date.daysTo(QDate::currentDate()) > staleDays;
+}
+
+CurrencyRates::CurrencyRates(QObject *parent)
+    : QObject(parent)
+{
+}
+
+CurrencyRates::~CurrencyRates() = default;
+
+QString CurrencyRates::cachePath() const
+{
+    const QString path = QString::fromLocal8Bit(qgetenv("PLASMA_RUNNER_CONVERTER_RATES"));
+    if (!path.isEmpty()) {
+        return path;
+    }
+    return QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation) + QLatin1String("/libkunitconversion/currency.xml");
+}
+
+QSharedPointer<const CurrencyRates::Snapshot> CurrencyRates::snapshot() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_snapshot;
+}
+
+bool CurrencyRates::load(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    const QSharedPointer<const Snapshot> snapshot = parse(file.readAll());
+    if (!snapshot) {
+        qWarning() << "Invalid exchange rates in" << path;
+        return false;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    m_snapshot = snapshot;
+    return true;
+}
+
+void CurrencyRates::prepare()
+{
+    const QString path = cachePath();
+    const QFileInfo info(path);
+    // a few kilobytes, read again only after they changed
+    if (info.exists() && info.lastModified() != m_loadedModified && load(path)) {
+        m_loadedModified = info.lastModified();
+    }
+
+    if (qEnvironmentVariableIsSet("PLASMA_RUNNER_CONVERTER_RATES") || m_downloading) {
+        return;
+    }
+
+    const QDateTime now = QDateTime::currentDateTime();
+    if (info.exists() && info.lastModified().secsTo(now) < updateInterval) {
+        return;
+    }
+    if (m_lastDownload.isValid() && m_lastDownload.secsTo(now) < retryInterval) {
+        return;
+    }
+
+    m_downloading = true;
+    m_lastDownload = now;
+    KIO::StoredTransferJob *job = KIO::storedGet(QUrl(ratesUrl), KIO::Reload, KIO::HideProgressInfo);
+    connect(job, &KJob::result, this, &CurrencyRates::downloadFinished);
+}
+
+void CurrencyRates::downloadFinished(KJob *job)
+{
+    m_downloading = false;
+    if (job->error()) {
+        qWarning() << "Could not update the exchange rates:" << job->errorString();
+        return;
+    }
+
+    const QByteArray data = static_cast<KIO::StoredTransferJob *>(job)->data();
+    const QSharedPointer<const Snapshot> snapshot = parse(data);
+    if (!snapshot) {
+        qWarning() << "Downloaded invalid exchange rates";
+        return;
+    }
+
+    // shared with KUnitConversion, which must never see half of it
+    const QString path = cachePath();
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile file(path);
+    if (file.open(QIODevice::WriteOnly) && file.write(data) == data.size() && file.commit()) {
+        m_loadedModified = QFileInfo(path).lastModified();
+    }
+
+    QMutexLocker locker(&m_mutex);
+    m_snapshot = snapshot;
+}
@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2020 by the Plasma Addons authors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CURRENCYRATES_H
+#define CURRENCYRATES_H
+
+#include <QDate>
+#include <QDateTime>
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QSharedPointer>
+
+#include <KUnitConversion/Value>
+
+class KJob;
+
+/**
+ * The exchange rates of the European Central Bank, as cached by KUnitConversion.
+ *
+ * KUnitConversion downloads new rates while converting when its cache is a
+ * day old, which blocks the query. Instead, the runner converts currencies with
+ * a snapshot of the cache, read when a query session starts, and downloads new
+ * rates in the background; they are used as soon as they have arrived.
+ *
+ * PLASMA_RUNNER_CONVERTER_RATES may name a file to read the rates from
+ * instead, which is never updated.
+ */
+class CurrencyRates : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Snapshot {
+        // the day the rates were published
+        QDate date;
+        // units of each currency per euro, by ISO code, including the fixed
+        // rates of the currencies the euro replaced
+        QHash<QString, double> rates;
+
+        /**
+         * Returns @p value converted to @p unit, or an invalid value
+         * if there is no rate for either of the currencies.
+         */
+        KUnitConversion::Value convert(const KUnitConversion::Value &value, const KUnitConversion::Unit &unit) const;
+
+        /**
+         * @return whether the rates are older than they should be,
+         * even on a Monday after a bank holiday
+         */
+        bool isStale() const;
+    };
+
+    explicit CurrencyRates(QObject *parent = nullptr);
+    ~CurrencyRates() override;
+
+    /**
+     * Returns the current rates, or a null pointer if there are none yet.
+     * Can be called from any thread.
+     */
+    QSharedPointer<const Snapshot> snapshot() const;
+
+public Q_SLOTS:
+    /**
+     * Reads the cache if it changed and starts downloading new rates if it is
+     * too old. Never blocks on the network.
+     */
+    void prepare();
+
+private Q_SLOTS:
+    void downloadFinished(KJob *job);
+
+private:
+    QString cachePath() const;
+    bool load(const QString &path);
+
+    mutable QMutex m_mutex;
+    QSharedPointer<const Snapshot> m_snapshot;
+    QDateTime m_loadedModified;
+    QDateTime m_lastDownload;
+    bool m_downloading = false;
+};
+
+#endif
@@ -0,0 +1,168 @@
+/*
+ * Copyright (C) 2020 by the Plasma Addons authors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "queryparser.h"
+
+QueryParser::QueryParser(const QString &s, const QStringList &separators)
+    : m_index(0), m_s(s), m_separators(separators)
+{
+    parse();
+}
+
+void QueryParser::parse()
+{
+    // the unit may come first, as in "$ 5"
+    passWhiteSpace();
+    const QString prefixUnit = isNumberStart() ? QString() : unit();
+
+    while (true) {
+        passWhiteSpace();
+        if (!isNumberStart()) {
+            break;
+        }
+
+        Term term;
+        if (!product(&term.number)) {
+            return;
+        }
+        passWhiteSpace();
+        term.unit = m_terms.isEmpty() && !prefixUnit.isEmpty() ? prefixUnit : unit();
+        if (term.unit.isEmpty()) {
+            return;
+        }
+
+        // units with two words, like "light year"
+        const int index = m_index;
+        passWhiteSpace();
+        if (!isNumberStart()) {
+            const QString word = unit();
+            if (!word.isEmpty() && !m_separators.contains(word)) {
+                term.unit += QLatin1Char(' ') + word;
+            } else {
+                m_index = index;
+            }
+        }
+        m_terms.append(term);
+    }
+
+    if (m_terms.isEmpty()) {
+        return;
+    }
+
+    passWhiteSpace();
+    for (const QString &separator : qAsConst(m_separators)) {
+        if (m_s.midRef(m_index).startsWith(separator)
+            && (separator == QString(CONVERSION_CHAR) || next(separator.size()).isSpace() || next(separator.size()).isNull())) {
+            m_index += separator.size();
+            break;
+        }
+    }
+    m_target = m_s.mid(m_index).simplified();
+    m_valid = true;
+}
+
+bool QueryParser::product(double *result)
+{
+    if (!number(result)) {
+        return false;
+    }
+    while (true) {
+        const int index = m_index;
+        passWhiteSpace();
+        const QChar op = next();
+        if (op != QLatin1Char('*') && op != QLatin1Char('/') && op != QChar(0x00D7)) {
+            m_index = index;
+            break;
+        }
+        ++m_index;
+        passWhiteSpace();
+        if (!isNumberStart()) {
+            // not an operand, but a unit like "/h"
+            m_index = index;
+            break;
+        }
+
+        double operand;
+        if (!number(&operand)) {
+            return false;
+        }
+        if (op == QLatin1Char('/')) {
+            if (qFuzzyIsNull(operand)) {
+                return false;
+            }
+            *result /= operand;
+        } else {
+            *result *= operand;
+        }
+    }
+    return true;
+}
+
+bool QueryParser::number(double *result)
+{
+    const int start = m_index;
+    if (next() == QLatin1Char('-') || next() == QLatin1Char('+')) {
+        ++m_index;
+    }
+    while (next().isDigit() || next() == QLatin1Char('.') || next() == QLatin1Char(',')) {
+        ++m_index;
+    }
+
+    const QStringRef text = m_s.midRef(start, m_index - start);
+    bool ok;
+    *result = m_locale.toDouble(text, &ok);
+    if (!ok) {
+        *result = text.toDouble(&ok);
+    }
+    return ok;
+}
+
+QString QueryParser::unit()
+{
+    const int start = m_index;
+    while (!next().isNull() && !next().isSpace() && !next().isDigit() && next() != CONVERSION_CHAR) {
+        ++m_index;
+    }
+    return m_s.mid(start, m_index - start);
+}
+
+bool QueryParser::isNumberStart() const
+{
+    if (next().isDigit()) {
+        return true;
+    }
+    const QChar c = next();
+    if (c == QLatin1Char('-') || c == QLatin1Char('+') || c == QLatin1Char('.') || c == QLatin1Char(',')) {
+        return next(1).isDigit() || ((c == QLatin1Char('-') || c == QLatin1Char('+')) && next(1) == QLatin1Char('.') && next(2).isDigit());
+    }
+    return false;
+}
+
+void QueryParser::passWhiteSpace()
+{
+    while (next().isSpace()) {
+        ++m_index;
+    }
+}
+
+QChar QueryParser::next(int offset) const
+{
+    if (m_index + offset >= m_s.size()) {
+        return QChar::Null;
+    }
+    return m_s.at(m_index + offset);
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2020 by the Plasma Addons authors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef QUERYPARSER_H
+#define QUERYPARSER_H
+
+#include <QLocale>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#define CONVERSION_CHAR QLatin1Char( '>' )
+
+/**
+ * Splits a query like "3ft 4in to cm", "2*1.5 kg in lb", "10 km/h > m/s" or
+ * "$ 5" into the amount, made up of one or more numbers with a unit each,
+ * and the unit to convert to, if any. The numbers may be products and
+ * quotients, and are evaluated right away.
+ */
+class QueryParser
+{
+public:
+    struct Term {
+        double number;
+        QString unit;
+    };
+
+    QueryParser(const QString &s, const QStringList &separators);
+
+    bool isValid() const
+    {
+        return m_valid;
+    }
+
+    QVector<Term> terms() const
+    {
+        return m_terms;
+    }
+
+    QString target() const
+    {
+        return m_target;
+    }
+
+private:
+    void parse();
+    // numbers multiplied and divided by each other, like "2*1.5" or "1/2"
+    bool product(double *result);
+    bool number(double *result);
+    QString unit();
+    bool isNumberStart() const;
+    void passWhiteSpace();
+    QChar next(int offset = 0) const;
+
+    int m_index;
+    QString m_s;
+    QStringList m_separators;
+    QLocale m_locale;
+    QVector<Term> m_terms;
+    QString m_target;
+    bool m_valid = false;
+};
+
+#endif
@@ -0,0 +1,167 @@
+/*
+ * Copyright (C) 2020 by the Plasma Addons authors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "unitindex.h"
+
+#include <QSet>
+
+#include <KUnitConversion/UnitCategory>
+
+#include <algorithm>
+
+void UnitIndex::build(const KUnitConversion::Converter &converter)
+{
+    m_nodes.clear();
+    m_entries.clear();
+    m_nodes.append(Node());
+
+    const QList<KUnitConversion::UnitCategory> categories = converter.categories();
+    for (const KUnitConversion::UnitCategory &category : categories) {
+        const QStringList names = category.allUnits();
+        for (const QString &name : names) {
+            m_entries.append({ category.id(), category.unit(name).id(), name });
+            insert(name.toCaseFolded(), m_entries.count() - 1);
+        }
+    }
+}
+
+bool UnitIndex::isEmpty() const
+{
+    return m_entries.isEmpty();
+}
+
+int UnitIndex::findChild(int node, QChar first) const
+{
+    for (int child : m_nodes.at(node).children) {
+        if (m_nodes.at(child).label.at(0) == first) {
+            return child;
+        }
+    }
+    return -1;
+}
+
+void UnitIndex::insert(const QString &key, int entry)
+{
+    int node = 0;
+    int pos = 0;
+    while (pos < key.size()) {
+        const int child = findChild(node, key.at(pos));
+        if (child < 0) {
+            Node leaf;
+            leaf.label = key.mid(pos);
+            m_nodes.append(leaf);
+            m_nodes[node].children.append(m_nodes.count() - 1);
+            node = m_nodes.count() - 1;
+            break;
+        }
+
+        const QString label = m_nodes.at(child).label;
+        int common = 1;
+        while (common < label.size() && pos + common < key.size() && label.at(common) == key.at(pos + common)) {
+            ++common;
+        }
+
+        if (common < label.size()) {
+            // the key leaves the edge halfway, split it there
+            Node middle;
+            middle.label = label.left(common);
+            middle.children.append(child);
+            m_nodes[child].label = label.mid(common);
+            m_nodes.append(middle);
+            QVector<int> &children = m_nodes[node].children;
+            children[children.indexOf(child)] = m_nodes.count() - 1;
+            node = m_nodes.count() - 1;
+        } else {
+            node = child;
+        }
+        pos += common;
+    }
+    m_nodes[node].entries.append(entry);
+}
+
+int UnitIndex::findNode(const QString &key, bool prefix) const
+{
+    if (m_nodes.isEmpty()) {
+        return -1;
+    }
+
+    int node = 0;
+    int pos = 0;
+    while (pos < key.size()) {
+        node = findChild(node, key.at(pos));
+        if (node < 0) {
+            return -1;
+        }
+
+        const QString &label = m_nodes.at(node).label;
+        const QStringRef rest = key.midRef(pos);
+        if (rest.startsWith(label)) {
+            pos += label.size();
+        } else if (prefix && label.startsWith(rest)) {
+            // the key ends halfway along the edge, everything below starts with it
+            return node;
+        } else {
+            return -1;
+        }
+    }
+    return node;
+}
+
+QVector<UnitIndex::Entry> UnitIndex::find(const QString &name) const
+{
+    QVector<Entry> result;
+    const int node = findNode(name.toCaseFolded(), false);
+    if (node >= 0) {
+        for (int entry : m_nodes.at(node).entries) {
+            result.append(m_entries.at(entry));
+        }
+    }
+    return result;
+}
+
+QVector<UnitIndex::Entry> UnitIndex::findPrefix(const QString &prefix, KUnitConversion::CategoryId category) const
+{
+    QVector<Entry> result;
+    const int start = findNode(prefix.toCaseFolded(), true);
+    if (start < 0) {
+        return result;
+    }
+
+    // in the order of insertion, which is that of KUnitConversion
+    QVector<int> entries;
+    QVector<int> pending { start };
+    while (!pending.isEmpty()) {
+        const Node &node = m_nodes.at(pending.takeLast());
+        for (int entry : node.entries) {
+            if (m_entries.at(entry).category == category) {
+                entries.append(entry);
+            }
+        }
+        pending += node.children;
+    }
+    std::sort(entries.begin(), entries.end());
+
+    QSet<KUnitConversion::UnitId> seen;
+    for (int entry : entries) {
+        const Entry &unit = m_entries.at(entry);
+        if (!seen.contains(unit.unit)) {
+            seen.insert(unit.unit);
+            result.append(unit);
+        }
+    }
+    return result;
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2020 by the Plasma Addons authors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef UNITINDEX_H
+#define UNITINDEX_H
+
+#include <QString>
+#include <QVector>
+
+#include <KUnitConversion/Converter>
+
+/**
+ * All names of all units of a converter, in a radix tree keyed by their
+ * case folded spelling, so looking a name or the beginning of one up only
+ * takes as many steps as it has characters.
+ */
+class UnitIndex
+{
+public:
+    struct Entry {
+        KUnitConversion::CategoryId category;
+        KUnitConversion::UnitId unit;
+        // as spelled by KUnitConversion, which is what KUnitConversion::UnitCategory::unit() takes
+        QString name;
+    };
+
+    void build(const KUnitConversion::Converter &converter);
+    bool isEmpty() const;
+
+    /**
+     * Returns the units named @p name, ignoring case, in the order of the
+     * categories of the converter.
+     */
+    QVector<Entry> find(const QString &name) const;
+
+    /**
+     * Returns the units of @p category with a name starting with @p prefix,
+     * ignoring case; every unit only once, under the first of its names.
+     */
+    QVector<Entry> findPrefix(const QString &prefix, KUnitConversion::CategoryId category) const;
+
+private:
+    struct Node {
+        // the case folded characters on the way from the parent
+        QString label;
+        QVector<int> children;
+        // indexes into m_entries of the names ending here
+        QVector<int> entries;
+    };
+
+    void insert(const QString &key, int entry);
+    int findNode(const QString &key, bool prefix) const;
+    int findChild(int node, QChar first) const;
+
+    QVector<Node> m_nodes;
+    QVector<Entry> m_entries;
+};
+
+#endif
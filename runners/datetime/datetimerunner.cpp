@@ -19,9 +19,14 @@
  */
 
 #include "datetimerunner.h"
+#include "timezoneindex.h"
 
+#include <QAtomicInt>
 #include <QLocale>
 #include <QIcon>
+#include <QMutex>
+#include <QRunnable>
+#include <QThreadPool>
 #include <QTimeZone>
 
 #include <KLocalizedString>
@@ -29,8 +34,57 @@
 static const QString dateWord = i18nc("Note this is a KRunner keyword", "date");
 static const QString timeWord = i18nc("Note this is a KRunner keyword", "time");
 
+/**
+ * The index of all time zones, built once by whoever needs it first.
+ */
+class SharedTimeZoneIndex
+{
+public:
+    void build()
+    {
+        if (ready.loadAcquire()) {
+            return;
+        }
+
+        QMutexLocker locker(&mutex);
+        if (!ready.loadAcquire()) {
+            index.build();
+            ready.storeRelease(1);
+        }
+    }
+
+    TimeZoneIndex index;
+    // set once the index is built, it does not change after that
+    QAtomicInt ready;
+
+private:
+    QMutex mutex;
+};
+
+/**
+ * Builds the index away from the GUI thread, a few hundred zones with
+ * all their names and abbreviations take a while.
+ */
+class BuildTimeZoneIndexThread : public QRunnable
+{
+public:
+    explicit BuildTimeZoneIndexThread(const QSharedPointer<SharedTimeZoneIndex> &timeZones)
+        : m_timeZones(timeZones)
+    {
+    }
+
+    void run() override
+    {
+        m_timeZones->build();
+    }
+
+private:
+    QSharedPointer<SharedTimeZoneIndex> m_timeZones;
+};
+
 DateTimeRunner::DateTimeRunner(QObject *parent, const QVariantList &args)
-    : Plasma::AbstractRunner(parent, args)
+    : Plasma::AbstractRunner(parent, args),
+      m_timeZones(new SharedTimeZoneIndex)
 {
     setObjectName(QLatin1String( "DataTimeRunner" ));
 
@@ -38,6 +92,8 @@ DateTimeRunner::DateTimeRunner(QObject *parent, const QVariantList &args)
     addSyntax(Plasma::RunnerSyntax(dateWord + QLatin1String( " :q:" ), i18n("Displays the current date in a given timezone")));
     addSyntax(Plasma::RunnerSyntax(timeWord, i18n("Displays the current time")));
     addSyntax(Plasma::RunnerSyntax(timeWord + QLatin1String( " :q:" ), i18n("Displays the current time in a given timezone")));
+
+    connect(this, &Plasma::AbstractRunner::prepare, this, &DateTimeRunner::prepareIndex);
 }
 
 DateTimeRunner::~DateTimeRunner()
@@ -70,38 +126,23 @@ void DateTimeRunner::match(Plasma::RunnerContext &context)
     }
 }
 
-QHash<QString, QDateTime> DateTimeRunner::datetime(const QStringRef& tz)
+void DateTimeRunner::prepareIndex()
 {
-    QHash<QString, QDateTime> ret;
-    //
-    // KTimeZone gives us the actual timezone names such as "Asia/Kolkatta" and does
-    // not give us country info. QTimeZone does not give us the actual timezone name
-    // This is why we are using both for now.
-    //
-    const QList<QByteArray> timeZoneIds = QTimeZone::availableTimeZoneIds();
-    for (const QByteArray& zoneId : timeZoneIds) {
-        QTimeZone timeZone(zoneId);
-
-        const QString zoneName = QString::fromUtf8(zoneId);
-        if (zoneName.contains(tz, Qt::CaseInsensitive)) {
-            ret[zoneName] = QDateTime::currentDateTimeUtc().toTimeZone(timeZone);
-            continue;
-        }
+    if (!m_timeZones->ready.loadAcquire()) {
+        QThreadPool::globalInstance()->start(new BuildTimeZoneIndexThread(m_timeZones));
+    }
+}
 
-        const QString country = QLocale::countryToString(timeZone.country());
-        if (country.contains(tz, Qt::CaseInsensitive)) {
-            ret[country] = QDateTime::currentDateTimeUtc().toTimeZone(timeZone);
-            continue;
-        }
+QHash<QString, QDateTime> DateTimeRunner::datetime(const QStringRef& tz)
+{
+    // in case the query did not come with a prepare(), or comes before the index is built
+    m_timeZones->build();
 
-        // FIXME: This only includes the current abbreviation and not old abbreviation or
-        // other possible names.
-        // Eg - depending on the current date, only CET or CEST will work
-        const QString abbr = timeZone.abbreviation(QDateTime::currentDateTime());
-        if (abbr.contains(tz, Qt::CaseInsensitive)) {
-            ret[abbr] = QDateTime::currentDateTimeUtc().toTimeZone(timeZone);
-            continue;
-        }
+    QHash<QString, QDateTime> ret;
+    const QDateTime now = QDateTime::currentDateTimeUtc();
+    const QVector<TimeZoneIndex::Match> matches = m_timeZones->index.search(tz);
+    for (const TimeZoneIndex::Match &match : matches) {
+        ret[match.name] = now.toTimeZone(QTimeZone(match.zoneId));
     }
 
     return ret;
@@ -20,10 +20,13 @@
 #define DATETIMERUNNER_H
 
 #include <QDateTime>
+#include <QSharedPointer>
 
 #include <KRunner/AbstractRunner>
 #include <KRunner/QueryMatch>
 
+class SharedTimeZoneIndex;
+
 /**
  * This class looks for matches in the set of .desktop files installed by
  * applications. This way the user can type exactly what they see in the
@@ -41,10 +44,16 @@ public:
 
     void match(Plasma::RunnerContext &context) override;
 
+private Q_SLOTS:
+    void prepareIndex();
+
 private:
     QHash<QString, QDateTime> datetime(const QStringRef &tz);
     void addMatch(const QString &text, const QString &clipboardText,
                   Plasma::RunnerContext &context, const QString& iconName);
+
+    // shared with the thread which builds it, which may outlive the runner
+    QSharedPointer<SharedTimeZoneIndex> m_timeZones;
 };
 
 #endif
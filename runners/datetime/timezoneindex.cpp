@@ -0,0 +1,157 @@
+/*
+ *   Copyright (C) 2020 by the Plasma Addons authors
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Library General Public License version 2 as
+ *   published by the Free Software Foundation
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details
+ *
+ *   You should have received a copy of the GNU Library General Public
+ *   License along with this program; if not, write to the
+ *   Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "timezoneindex.h"
+
+#include <QDateTime>
+#include <QLocale>
+#include <QSet>
+#include <QTimeZone>
+
+namespace {
+
+quint64 trigram(const QChar *text)
+{
+    return quint64(text[0].unicode()) << 32 | quint64(text[1].unicode()) << 16 | text[2].unicode();
+}
+
+}
+
+void TimeZoneIndex::build()
+{
+    m_zones.clear();
+    m_names.clear();
+    m_trigrams.clear();
+
+    const QLocale locale;
+    const QDateTime now = QDateTime::currentDateTimeUtc();
+    // older abbreviations are mostly the local mean time of the city
+    const QDateTime since(QDate(1970, 1, 1), QTime(0, 0), Qt::UTC);
+
+    const QList<QByteArray> timeZoneIds = QTimeZone::availableTimeZoneIds();
+    for (const QByteArray &zoneId : timeZoneIds) {
+        const QTimeZone timeZone(zoneId);
+        const int zone = m_zones.count();
+        m_zones.append(zoneId);
+
+        const QString zoneName = QString::fromUtf8(zoneId);
+        addName(zone, zoneName, ZoneId);
+        // "America/Argentina/Buenos_Aires" is in "Buenos Aires"
+        const int slash = zoneName.lastIndexOf(QLatin1Char('/'));
+        if (slash >= 0) {
+            addName(zone, zoneName.mid(slash + 1).replace(QLatin1Char('_'), QLatin1Char(' ')), City);
+        }
+
+        if (timeZone.country() != QLocale::AnyCountry) {
+            addName(zone, QLocale::countryToString(timeZone.country()), Country);
+        }
+
+        QSet<QString> abbreviations;
+        abbreviations.insert(timeZone.abbreviation(now));
+        if (timeZone.hasTransitions()) {
+            const QTimeZone::OffsetDataList transitions = timeZone.transitions(since, now.addYears(1));
+            for (const QTimeZone::OffsetData &transition : transitions) {
+                abbreviations.insert(transition.abbreviation);
+            }
+        }
+        for (const QString &abbreviation : qAsConst(abbreviations)) {
+            addName(zone, abbreviation, Abbreviation);
+        }
+
+        addName(zone, timeZone.displayName(QTimeZone::StandardTime, QTimeZone::LongName, locale), LocalizedName);
+        if (timeZone.hasDaylightTime()) {
+            addName(zone, timeZone.displayName(QTimeZone::DaylightTime, QTimeZone::LongName, locale), LocalizedName);
+        }
+    }
+}
+
+void TimeZoneIndex::addName(int zone, const QString &text, Kind kind)
+{
+    if (text.isEmpty()) {
+        return;
+    }
+
+    const int id = m_names.count();
+    const QString folded = text.toCaseFolded();
+    m_names.append({ text, folded, zone, kind });
+
+    for (int i = 0; i + 3 <= folded.size(); ++i) {
+        QVector<int> &names = m_trigrams[trigram(folded.constData() + i)];
+        if (names.isEmpty() || names.last() != id) {
+            names.append(id);
+        }
+    }
+}
+
+bool TimeZoneIndex::isEmpty() const
+{
+    return m_zones.isEmpty();
+}
+
+QVector<TimeZoneIndex::Match> TimeZoneIndex::search(const QStringRef &text) const
+{
+    const QString folded = text.toString().toCaseFolded();
+    QVector<Match> result;
+    if (folded.isEmpty()) {
+        return result;
+    }
+
+    // the names sharing the rarest trigram, or all of them for one or two letters
+    const QVector<int> *candidates = nullptr;
+    for (int i = 0; i + 3 <= folded.size(); ++i) {
+        const auto it = m_trigrams.constFind(trigram(folded.constData() + i));
+        if (it == m_trigrams.constEnd()) {
+            return result;
+        }
+        if (!candidates || it->count() < candidates->count()) {
+            candidates = &it.value();
+        }
+    }
+
+    // the best name of each zone
+    QHash<int, int> best;
+    auto check = [this, &folded, &best](int id) {
+        const Name &name = m_names.at(id);
+        if (!name.folded.contains(folded)) {
+            return;
+        }
+        const auto it = best.find(name.zone);
+        if (it == best.end()) {
+            best.insert(name.zone, id);
+        } else if (name.kind < m_names.at(*it).kind) {
+            *it = id;
+        }
+    };
+    if (candidates) {
+        for (int id : *candidates) {
+            check(id);
+        }
+    } else {
+        for (int id = 0; id < m_names.count(); ++id) {
+            check(id);
+        }
+    }
+
+    result.reserve(best.count());
+    for (auto it = best.constBegin(); it != best.constEnd(); ++it) {
+        const Name &name = m_names.at(it.value());
+        const QByteArray &zoneId = m_zones.at(name.zone);
+        result.append({ zoneId, name.kind == City ? QString::fromUtf8(zoneId) : name.text, name.kind });
+    }
+    return result;
+}
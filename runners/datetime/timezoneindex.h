@@ -0,0 +1,77 @@
+/*
+ *   Copyright (C) 2020 by the Plasma Addons authors
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Library General Public License version 2 as
+ *   published by the Free Software Foundation
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details
+ *
+ *   You should have received a copy of the GNU Library General Public
+ *   License along with this program; if not, write to the
+ *   Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef TIMEZONEINDEX_H
+#define TIMEZONEINDEX_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+/**
+ * All names of all time zones: their ids, cities, countries, the
+ * abbreviations they used since 1970 and their localized names.
+ *
+ * Every name is listed under the trigrams it contains, so looking for
+ * a part of a name only has to check the names sharing its rarest trigram.
+ */
+class TimeZoneIndex
+{
+public:
+    // in the order in which they are preferred, if several names of a zone match
+    enum Kind {
+        ZoneId,
+        City,
+        Country,
+        Abbreviation,
+        LocalizedName
+    };
+
+    struct Match {
+        QByteArray zoneId;
+        // the name to show, the zone id for cities
+        QString name;
+        Kind kind;
+    };
+
+    void build();
+    bool isEmpty() const;
+
+    /**
+     * Returns the zones with a name containing @p text, ignoring case,
+     * each with its best matching name.
+     */
+    QVector<Match> search(const QStringRef &text) const;
+
+private:
+    struct Name {
+        QString text;
+        QString folded;
+        int zone;
+        Kind kind;
+    };
+
+    void addName(int zone, const QString &text, Kind kind);
+
+    QVector<QByteArray> m_zones;
+    QVector<Name> m_names;
+    QHash<quint64, QVector<int>> m_trigrams;
+};
+
+#endif
@@ -3,73 +3,113 @@
  */
 
 #include "dictionarymatchengine.h"
-#include <KRunner/AbstractRunner>
-#include <QThread>
-#include <QMetaMethod>
+#include <QTimer>
 #include <QDebug>
-#if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
-#include <QDeadlineTimer>
-#endif
+
+namespace {
+// the data engine is only asked once the user stopped typing for this long
+const int debounceInterval = 300;
+// requests the data engine did not answer in time are given up
+const int requestTimeout = 30 * 1000;
+// definitions kept until the end of the query session
+const int cacheSize = 64;
+}
+
 DictionaryMatchEngine::DictionaryMatchEngine(Plasma::DataEngine *dictionaryEngine, QObject *parent)
     : QObject(parent),
+      m_definitions(cacheSize),
+      m_debounceTimer(new QTimer(this)),
       m_dictionaryEngine(dictionaryEngine)
 {
-    /* We have to connect source in two different places, due to the difference in
-     * how the connection is made based on data availability. There are two cases,
-     * and this extra connection handles the second case. */
     Q_ASSERT(m_dictionaryEngine);
-    connect(m_dictionaryEngine, SIGNAL(sourceAdded(QString)), this, SLOT(sourceAdded(QString)));
+    m_debounceTimer->setSingleShot(true);
+    m_debounceTimer->setInterval(debounceInterval);
+    connect(m_debounceTimer, &QTimer::timeout, this, &DictionaryMatchEngine::sendLastWord);
+}
+
+bool DictionaryMatchEngine::cachedDefinition(const QString &word, QString *definition)
+{
+    QMutexLocker locker(&m_mutex);
+    const QString *cached = m_definitions.object(word);
+    if (!cached) {
+        return false;
+    }
+    *definition = *cached;
+    return true;
 }
 
-/* This function should be called from a different thread. */
-QString DictionaryMatchEngine::lookupWord(const QString &word)
+void DictionaryMatchEngine::requestDefinition(const QString &word, const Callback &callback)
 {
     if (!m_dictionaryEngine) {
         qDebug() << "Could not find dictionary data engine.";
-        return QString();
-    }
-    if (thread() == QThread::currentThread()) {
-        qDebug() << "DictionaryMatchEngine::lookupWord is only meant to be called from non-primary threads.";
-        return QString();
+        return;
     }
 
-    ThreadData data;
-
-    m_wordLock.lockForWrite();
-    m_lockers.insert(word, &data);
-    m_wordLock.unlock();
-
-    QMetaObject::invokeMethod(this, "sourceAdded", Qt::QueuedConnection, Q_ARG(const QString&, word));
-    QMutexLocker locker(&data.mutex);
-#if QT_VERSION < QT_VERSION_CHECK(5, 15, 0)
-    if (!data.waitCondition.wait(&data.mutex, 30 * 1000)) // Timeout after 30 seconds
-#else
-    if (!data.waitCondition.wait(&data.mutex, QDeadlineTimer(30 * 1000))) // Timeout after 30 seconds
-#endif
-        qDebug() << "The dictionary data engine timed out (word:" << word << ")";
-    locker.unlock();
+    {
+        QMutexLocker locker(&m_mutex);
+        Request &request = m_requests[word];
+        request.callbacks.append(callback);
+        // already on its way, the answer is shared
+        if (request.send) {
+            return;
+        }
+        m_lastWord = word;
+    }
 
-    QMetaObject::invokeMethod(this, "sourceRemoved", Qt::QueuedConnection, Q_ARG(const QString&, word));
-    // after a timeout, if dataUpdated gets m_wordLock here, it can lock data->mutex successfully.
+    // restarted with every request, so only the last one of a burst is sent
+    QMetaObject::invokeMethod(m_debounceTimer, "start", Qt::QueuedConnection);
+}
 
-    m_wordLock.lockForWrite();
-    m_lockers.remove(word, &data);
-    m_wordLock.unlock();
+void DictionaryMatchEngine::sendLastWord()
+{
+    QString word;
+    quint64 send = 0;
+    {
+        QMutexLocker locker(&m_mutex);
+        for (auto it = m_requests.begin(); it != m_requests.end();) {
+            if (!it->send && it.key() != m_lastWord) {
+                // superseded while the user was typing
+                it = m_requests.erase(it);
+            } else {
+                ++it;
+            }
+        }
 
-    // after a timeout, if dataUpdated gets m_wordLock here, it won't see this data instance anymore.
+        auto it = m_requests.find(m_lastWord);
+        if (it != m_requests.end() && !it->send) {
+            it->send = send = ++m_sends;
+            word = m_lastWord;
+        }
+    }
 
-    locker.relock();
-    return data.definition;
+    if (!word.isEmpty()) {
+        m_dictionaryEngine->connectSource(word, this);
+        // expired by the timer of this very send, however early a coarse timer fires
+        QTimer::singleShot(requestTimeout, this, [this, word, send] {
+            expireRequest(word, send);
+        });
+    }
 }
 
-void DictionaryMatchEngine::sourceAdded(const QString &source)
+void DictionaryMatchEngine::expireRequest(const QString &word, quint64 send)
 {
-    m_dictionaryEngine->connectSource(source, this);
+    {
+        QMutexLocker locker(&m_mutex);
+        auto it = m_requests.find(word);
+        // answered meanwhile, and maybe asked for again
+        if (it == m_requests.end() || it->send != send) {
+            return;
+        }
+        qDebug() << "The dictionary data engine timed out (word:" << word << ")";
+        m_requests.erase(it);
+    }
+    m_dictionaryEngine->disconnectSource(word, this);
 }
 
-void DictionaryMatchEngine::sourceRemoved(const QString &source)
+void DictionaryMatchEngine::clearCache()
 {
-    m_dictionaryEngine->disconnectSource(source, this);
+    QMutexLocker locker(&m_mutex);
+    m_definitions.clear();
 }
 
 void DictionaryMatchEngine::dataUpdated(const QString &source, const Plasma::DataEngine::Data &result)
@@ -77,16 +117,17 @@ void DictionaryMatchEngine::dataUpdated(const QString &source, const Plasma::Dat
     if (!result.contains(QLatin1String("text")))
         return;
 
-    QString definition(result[QLatin1String("text")].toString());
+    const QString definition(result[QLatin1String("text")].toString());
 
-    m_wordLock.lockForRead();
-    foreach (ThreadData *data, m_lockers.values(source)) {
-        QMutexLocker locker(&data->mutex);
-        /* Because of QString's CoW semantics, we don't have to worry about
-         * the overhead of assigning this to every item. */
-        data->definition = definition;
-        data->waitCondition.wakeOne();
+    QVector<Callback> callbacks;
+    {
+        QMutexLocker locker(&m_mutex);
+        m_definitions.insert(source, new QString(definition));
+        callbacks = m_requests.take(source).callbacks;
     }
-    m_wordLock.unlock();
-}
+    m_dictionaryEngine->disconnectSource(source, this);
 
+    for (const Callback &callback : qAsConst(callbacks)) {
+        callback(definition);
+    }
+}
@@ -6,38 +6,68 @@
 #define DICTIONARYMATCHENGINE_H
 
 #include <Plasma/DataEngine>
+#include <QCache>
 #include <QHash>
-#include <QReadWriteLock>
 #include <QMutex>
-#include <QMultiMap>
-#include <QWaitCondition>
+#include <QSet>
+#include <QVector>
 
-namespace Plasma
-{
-}
+#include <functional>
+
+class QTimer;
+
+/**
+ * Looks words up in the dict data engine without blocking the calling thread.
+ *
+ * Definitions are kept in a cache until clearCache() is called. Requests for
+ * a word which is already being looked up share the answer, and while the
+ * user is still typing only the last word requested is looked up at all.
+ */
 class DictionaryMatchEngine : public QObject
 {
     Q_OBJECT
 
 public:
+    typedef std::function<void(const QString &definition)> Callback;
+
     explicit DictionaryMatchEngine(Plasma::DataEngine *dictionaryEngine, QObject *parent = nullptr);
-    QString lookupWord(const QString &word);
+
+    /**
+     * Sets @p definition to the cached definition of @p word, if there is one.
+     * Can be called from any thread.
+     */
+    bool cachedDefinition(const QString &word, QString *definition);
+
+    /**
+     * Looks @p word up and calls @p callback with its definition, in the thread
+     * of the engine. The callback is dropped without being called if another
+     * word is requested before this one was sent to the data engine, or if the
+     * data engine does not answer. Can be called from any thread.
+     */
+    void requestDefinition(const QString &word, const Callback &callback);
+
+public Q_SLOTS:
+    void clearCache();
 
 private:
-    struct ThreadData {
-        QWaitCondition waitCondition;
-        QMutex mutex;
-        QString definition;
+    struct Request {
+        QVector<Callback> callbacks;
+        // the number of the send to the data engine, 0 until the word was sent
+        quint64 send = 0;
     };
-    QMultiMap <QString, ThreadData*> m_lockers;
-    QReadWriteLock m_wordLock;
+
+    QMutex m_mutex;
+    QCache<QString, QString> m_definitions;
+    QHash<QString, Request> m_requests;
+    QString m_lastWord;
+    quint64 m_sends = 0;
+    QTimer *m_debounceTimer;
     Plasma::DataEngine *m_dictionaryEngine;
 
 private Q_SLOTS:
+    void sendLastWord();
+    void expireRequest(const QString &word, quint64 send);
     void dataUpdated(const QString &name, const Plasma::DataEngine::Data &data);
-    void sourceAdded(const QString &source);
-    void sourceRemoved(const QString &source);
-
 };
 
 #endif
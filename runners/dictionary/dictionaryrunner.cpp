@@ -4,9 +4,13 @@
 
 #include "dictionaryrunner.h"
 
+#include <dictparser.h>
+
 #include <QStringList>
 #include <klocalizedstring.h>
 
+#include <memory>
+
 static const char CONFIG_TRIGGERWORD[] = "triggerWord";
 
 DictionaryRunner::DictionaryRunner(QObject *parent, const QVariantList &args)
@@ -20,6 +24,8 @@ DictionaryRunner::DictionaryRunner(QObject *parent, const QVariantList &args)
     setIgnoredTypes(Plasma::RunnerContext::Directory | Plasma::RunnerContext::File |
             Plasma::RunnerContext::NetworkLocation | Plasma::RunnerContext::Executable |
             Plasma::RunnerContext::ShellCommand);
+
+    connect(this, &Plasma::AbstractRunner::teardown, m_engine, &DictionaryMatchEngine::clearCache);
 }
 
 void DictionaryRunner::init()
@@ -44,39 +50,40 @@ void DictionaryRunner::match(Plasma::RunnerContext &context)
     query.remove(0, m_triggerWord.length());
     if (query.isEmpty())
         return;
-    QString returnedQuery = m_engine->lookupWord(query);
 
-    if (!context.isValid())
+    QString definition;
+    if (m_engine->cachedDefinition(query, &definition)) {
+        context.addMatches(matchesForDefinition(query, definition));
         return;
+    }
 
-    static const QRegExp removeHtml(QLatin1String("<[^>]*>"));
-    QString definitions(returnedQuery);
-    definitions.remove(QLatin1Char('\r')).remove(removeHtml);
-    while (definitions.contains(QLatin1String("  ")))
-        definitions.replace(QLatin1String("  "), QLatin1String(" "));
-    QStringList lines = definitions.split(QLatin1Char('\n'), QString::SkipEmptyParts);
-    if (lines.length() < 2)
-        return;
-    lines.removeFirst();
+    /* Rather than waiting for the data engine, the matches are added when the
+     * definition arrives. Copies of a context become invalid as soon as the
+     * query changes, so late definitions do not show up for other queries. */
+    std::shared_ptr<Plasma::RunnerContext> pendingContext(new Plasma::RunnerContext(context));
+    m_engine->requestDefinition(query, [this, pendingContext, query](const QString &definition) {
+        if (pendingContext->isValid())
+            pendingContext->addMatches(matchesForDefinition(query, definition));
+    });
+}
+
+QList<Plasma::QueryMatch> DictionaryRunner::matchesForDefinition(const QString &query, const QString &returnedQuery)
+{
+    const QVector<DictParser::Definition> definitions = DictParser::definitions(returnedQuery);
 
     QList<Plasma::QueryMatch> matches;
-    int item = 0;
-    static const QRegExp partOfSpeech(QLatin1String("(?: ([a-z]{1,5})){0,1} [0-9]{1,2}: (.*)"));
-    QString lastPartOfSpeech;
-    foreach (const QString &line, lines) {
-        if (partOfSpeech.indexIn(line) == -1)
-            continue;
-        if (!partOfSpeech.cap(1).isEmpty())
-            lastPartOfSpeech = partOfSpeech.cap(1);
+    matches.reserve(definitions.count());
+    for (int item = 0; item < definitions.count(); ++item) {
+        const DictParser::Definition &definition = definitions.at(item);
         Plasma::QueryMatch match(this);
-        match.setText(query + QLatin1String(": ") + lastPartOfSpeech);
-        match.setRelevance(1 - (static_cast<double>(++item) / static_cast<double>(lines.length())));
+        match.setText(query + QLatin1String(": ") + definition.partOfSpeech);
+        match.setRelevance(1 - (static_cast<double>(item + 1) / static_cast<double>(definitions.count() + 1)));
         match.setType(Plasma::QueryMatch::InformationalMatch);
         match.setIconName(QStringLiteral("accessories-dictionary"));
-        match.setSubtext(partOfSpeech.cap(2));
+        match.setSubtext(definition.text);
         matches.append(match);
     }
-    context.addMatches(matches);
+    return matches;
 }
 
 K_EXPORT_PLASMA_RUNNER(krunner_dictionary, DictionaryRunner)
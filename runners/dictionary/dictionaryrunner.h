@@ -18,6 +18,8 @@ public:
     void reloadConfiguration() override;
 
 private:
+    QList<Plasma::QueryMatch> matchesForDefinition(const QString &query, const QString &definition);
+
     QString m_triggerWord;
     DictionaryMatchEngine *m_engine;
 
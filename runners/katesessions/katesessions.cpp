@@ -29,8 +29,103 @@
 #include <KLocalizedString>
 #include <KToolInvocation>
 
+#include <algorithm>
+
 K_EXPORT_PLASMA_RUNNER(katesessionsrunner, KateSessions)
 
+namespace {
+
+// the weights of fzf: matched characters count most, and a match at
+// the start of a word or right after another one counts more than one
+// somewhere in the middle; every gap costs a little
+const int scoreMatch = 16;
+const int scoreGapStart = -3;
+const int scoreGapExtension = -1;
+const int bonusBoundary = 8;
+const int bonusConsecutive = -(scoreGapStart + scoreGapExtension);
+const int bonusFirstCharMultiplier = 2;
+
+int boundaryBonus(const QString &text, int i)
+{
+    return i == 0 || !text.at(i - 1).isLetterOrNumber() ? bonusBoundary : 0;
+}
+
+/**
+ * Returns how well @p pattern matches @p text as a subsequence, or -1 if it
+ * does not. Of all the places it matches, the shortest one ending at the
+ * first place where all of @p pattern was seen is scored, like fzf does.
+ */
+int fuzzyScore(const QString &pattern, const QString &text)
+{
+    const int patternLength = pattern.size();
+    const int textLength = text.size();
+    if (patternLength == 0 || patternLength > textLength) {
+        return -1;
+    }
+
+    int p = 0;
+    int end = -1;
+    for (int i = 0; i < textLength; ++i) {
+        if (text.at(i) == pattern.at(p) && ++p == patternLength) {
+            end = i + 1;
+            break;
+        }
+    }
+    if (end < 0) {
+        return -1;
+    }
+
+    int start = 0;
+    p = patternLength - 1;
+    for (int i = end - 1; i >= 0; --i) {
+        if (text.at(i) == pattern.at(p) && --p < 0) {
+            start = i;
+            break;
+        }
+    }
+
+    int score = 0;
+    int consecutive = 0;
+    int firstBonus = 0;
+    bool inGap = false;
+    p = 0;
+    for (int i = start; i < end; ++i) {
+        if (p < patternLength && text.at(i) == pattern.at(p)) {
+            int bonus = boundaryBonus(text, i);
+            if (consecutive == 0) {
+                firstBonus = bonus;
+            } else {
+                // a run of matches is as good as its start
+                bonus = std::max({bonus, firstBonus, bonusConsecutive});
+            }
+            score += scoreMatch + (p == 0 ? bonus * bonusFirstCharMultiplier : bonus);
+            ++consecutive;
+            inGap = false;
+            ++p;
+        } else {
+            score += inGap ? scoreGapExtension : scoreGapStart;
+            inGap = true;
+            consecutive = 0;
+        }
+    }
+    return score;
+}
+
+// that of a pattern matching the start of a text
+int maxFuzzyScore(int patternLength)
+{
+    return patternLength * (scoreMatch + bonusBoundary) + bonusBoundary;
+}
+
+// 1 for sessions used today, down to 0.5 for those used a month ago
+qreal recency(const QDateTime &modified, const QDateTime &now)
+{
+    const qint64 days = std::max<qint64>(0, modified.daysTo(now));
+    return 1.0 / (1.0 + days / 30.0);
+}
+
+}
+
 KateSessions::KateSessions(QObject *parent, const QVariantList& args)
     : Plasma::AbstractRunner(parent, args)
 {
@@ -46,8 +141,9 @@ KateSessions::KateSessions(QObject *parent, const QVariantList& args)
     m_sessionsFolderPath = QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation)
                          + QLatin1String("/kate/sessions");
 
+    m_collator.setCaseSensitivity(Qt::CaseInsensitive);
+
     connect(this, SIGNAL(prepare()), SLOT(slotPrepare()));
-    connect(this, SIGNAL(teardown()), SLOT(slotTeardown()));
 }
 
 KateSessions::~KateSessions()
@@ -56,59 +152,116 @@ KateSessions::~KateSessions()
 
 void KateSessions::slotPrepare()
 {
+    // the sessions are listed once, and then kept up to date file by file
+    if (m_sessionWatch) {
+        return;
+    }
+
     loadSessions();
 
     // listen for changes to the list of kate sessions
-    if (!m_sessionWatch) {
-        m_sessionWatch = new KDirWatch(this);
-        m_sessionWatch->addDir(m_sessionsFolderPath);
-        connect(m_sessionWatch, &KDirWatch::dirty, this, &KateSessions::loadSessions);
-        connect(m_sessionWatch, &KDirWatch::created, this, &KateSessions::loadSessions);
-        connect(m_sessionWatch, &KDirWatch::deleted, this, &KateSessions::loadSessions);
-    }
-}
-
-void KateSessions::slotTeardown()
-{
-    delete m_sessionWatch;
-    m_sessionWatch = nullptr;
-    m_sessions.clear();
+    m_sessionWatch = new KDirWatch(this);
+    m_sessionWatch->addDir(m_sessionsFolderPath, KDirWatch::WatchFiles);
+    connect(m_sessionWatch, &KDirWatch::dirty, this, &KateSessions::updateSession);
+    connect(m_sessionWatch, &KDirWatch::created, this, &KateSessions::sessionCreated);
+    connect(m_sessionWatch, &KDirWatch::deleted, this, &KateSessions::removeSession);
 }
 
 void KateSessions::loadSessions()
 {
-    QStringList sessions;
-
     QDir sessionsDir(m_sessionsFolderPath);
 
     const auto &sessionFiles = sessionsDir.entryInfoList({QStringLiteral("*.katesession")}, QDir::Files);
 
+    std::vector<Session> sessions;
+    sessions.reserve(sessionFiles.count());
     for (const QFileInfo &sessionFile : sessionFiles) {
-        const QString name = QUrl::fromPercentEncoding(sessionFile.baseName().toLocal8Bit()); // is this the right encoding?
-        sessions.append(name);
+        sessions.push_back(readSession(sessionFile.absoluteFilePath()));
     }
 
-    QCollator collator;
-    collator.setCaseSensitivity(Qt::CaseInsensitive);
-    std::sort(sessions.begin(), sessions.end(), [&collator](const QString &a, const QString &b) {
-        return collator.compare(a, b) < 0;
+    std::sort(sessions.begin(), sessions.end(), [](const Session &a, const Session &b) {
+        return a.sortKey.compare(b.sortKey) < 0;
     });
 
-    m_sessions = sessions;
+    QWriteLocker locker(&m_sessionsLock);
+    m_sessions = std::move(sessions);
 }
 
-void KateSessions::match(Plasma::RunnerContext &context)
+KateSessions::Session KateSessions::readSession(const QString &path) const
+{
+    const QFileInfo sessionFile(path);
+    const QString name = QUrl::fromPercentEncoding(sessionFile.baseName().toLocal8Bit()); // is this the right encoding?
+    return {path, name, name.toCaseFolded(), m_collator.sortKey(name), sessionFile.lastModified()};
+}
+
+void KateSessions::insertSession(Session &&session)
+{
+    QWriteLocker locker(&m_sessionsLock);
+    const auto it = std::lower_bound(m_sessions.begin(), m_sessions.end(), session, [](const Session &a, const Session &b) {
+        return a.sortKey.compare(b.sortKey) < 0;
+    });
+    m_sessions.insert(it, std::move(session));
+}
+
+void KateSessions::sessionCreated(const QString &path)
+{
+    if (path == m_sessionsFolderPath) {
+        loadSessions();
+    } else {
+        updateSession(path);
+    }
+}
+
+void KateSessions::updateSession(const QString &path)
+{
+    // depending on the backend of KDirWatch, e.g. polling on NFS, a change
+    // may only be reported for the folder, so everything is listed again
+    if (path == m_sessionsFolderPath) {
+        loadSessions();
+        return;
+    }
+    if (!path.endsWith(QLatin1String(".katesession"))) {
+        return;
+    }
+
+    removeSession(path);
+    if (QFileInfo::exists(path)) {
+        insertSession(readSession(path));
+    }
+}
+
+void KateSessions::removeSession(const QString &path)
 {
-    if (m_sessions.isEmpty()) {
+    QWriteLocker locker(&m_sessionsLock);
+    if (path == m_sessionsFolderPath) {
+        m_sessions.clear();
         return;
     }
 
+    const auto it = std::find_if(m_sessions.begin(), m_sessions.end(), [&path](const Session &session) {
+        return session.path == path;
+    });
+    if (it != m_sessions.end()) {
+        m_sessions.erase(it);
+    }
+}
+
+void KateSessions::match(Plasma::RunnerContext &context)
+{
+    {
+        QReadLocker locker(&m_sessionsLock);
+        if (m_sessions.empty()) {
+            return;
+        }
+    }
+
     QString term = context.query();
     if (term.length() < 3) {
         return;
     }
 
     bool listAll = false;
+    bool prefixed = false;
 
     if (term.startsWith(QLatin1String("kate"), Qt::CaseInsensitive)) {
         if (term.trimmed().compare(QLatin1String("kate"), Qt::CaseInsensitive) == 0) {
@@ -117,6 +270,7 @@ void KateSessions::match(Plasma::RunnerContext &context)
         } else if (term.at(4) == QLatin1Char(' ') ) {
             term.remove(QLatin1String("kate"), Qt::CaseInsensitive);
             term = term.trimmed();
+            prefixed = true;
         } else {
             term.clear();
         }
@@ -126,35 +280,49 @@ void KateSessions::match(Plasma::RunnerContext &context)
         return;
     }
 
-    foreach (const QString &session, m_sessions) {
+    const QString foldedTerm = term.toCaseFolded();
+    const int maxScore = maxFuzzyScore(foldedTerm.size());
+    const QDateTime now = QDateTime::currentDateTime();
+
+    QList<Plasma::QueryMatch> matches;
+    QReadLocker locker(&m_sessionsLock);
+    for (const Session &session : m_sessions) {
         if (!context.isValid()) {
             return;
         }
 
-        if (listAll || (!term.isEmpty() && session.contains(term, Qt::CaseInsensitive))) {
-            Plasma::QueryMatch match(this);
-            if (listAll) {
-                // All sessions listed, but with a low priority
-                match.setType(Plasma::QueryMatch::ExactMatch);
-                match.setRelevance(0.8);
-            } else {
-                if (session.compare(term, Qt::CaseInsensitive) == 0) {
-                    // parameter to kate matches session exactly, bump it up!
-                    match.setType(Plasma::QueryMatch::ExactMatch);
-                    match.setRelevance(1.0);
-                } else {
-                    // fuzzy match of the session in "kate $session"
-                    match.setType(Plasma::QueryMatch::PossibleMatch);
-                    match.setRelevance(0.8);
-                }
+        Plasma::QueryMatch match(this);
+        if (listAll) {
+            // All sessions listed, but with a low priority, the recently used ones first
+            match.setType(Plasma::QueryMatch::ExactMatch);
+            match.setRelevance(0.7 + 0.1 * recency(session.modified, now));
+        } else if (session.foldedName == foldedTerm) {
+            // parameter to kate matches session exactly, bump it up!
+            match.setType(Plasma::QueryMatch::ExactMatch);
+            match.setRelevance(1.0);
+        } else {
+            // fuzzy match of the session in "kate $session"; any other query
+            // has to be part of the name, so KRunner is not flooded with sessions
+            if (!prefixed && !session.foldedName.contains(foldedTerm)) {
+                continue;
             }
-            match.setIconName(QStringLiteral("kate"));
-            match.setData(session);
-            match.setText(session);
-            match.setSubtext(i18n("Open Kate Session"));
-            context.addMatch(match);
+            const int score = fuzzyScore(foldedTerm, session.foldedName);
+            if (score < 0) {
+                continue;
+            }
+            const qreal quality = qBound(0.0, qreal(score) / maxScore, 1.0);
+            match.setType(Plasma::QueryMatch::PossibleMatch);
+            match.setRelevance(0.5 + 0.3 * quality + 0.1 * recency(session.modified, now));
         }
+        match.setIconName(QStringLiteral("kate"));
+        match.setData(session.name);
+        match.setText(session.name);
+        match.setSubtext(i18n("Open Kate Session"));
+        matches.append(match);
     }
+    locker.unlock();
+
+    context.addMatches(matches);
 }
 
 void KateSessions::run(const Plasma::RunnerContext &context, const Plasma::QueryMatch &match)
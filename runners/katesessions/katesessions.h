@@ -23,6 +23,12 @@
 
 #include <krunner/abstractrunner.h>
 
+#include <QCollator>
+#include <QDateTime>
+#include <QReadWriteLock>
+
+#include <vector>
+
 class KDirWatch;
 
 class KateSessions : public Plasma::AbstractRunner {
@@ -38,12 +44,28 @@ class KateSessions : public Plasma::AbstractRunner {
     private Q_SLOTS:
         void loadSessions();
         void slotPrepare();
-        void slotTeardown();
+        void sessionCreated(const QString &path);
+        void updateSession(const QString &path);
+        void removeSession(const QString &path);
 
     private:
+        struct Session {
+            QString path;
+            QString name;
+            QString foldedName;
+            QCollatorSortKey sortKey;
+            QDateTime modified;
+        };
+
+        Session readSession(const QString &path) const;
+        void insertSession(Session &&session);
+
         KDirWatch* m_sessionWatch = nullptr;
         QString m_sessionsFolderPath;
-        QStringList m_sessions;
+        QCollator m_collator;
+        // sorted by name, kept up to date by m_sessionWatch
+        std::vector<Session> m_sessions;
+        QReadWriteLock m_sessionsLock;
 };
 
 #endif
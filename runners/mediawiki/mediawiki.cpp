@@ -23,6 +23,7 @@
 // KF
 #include <KRunner/RunnerContext>
 // Qt
+#include <QHash>
 #include <QNetworkAccessManager>
 #include <QNetworkRequest>
 #include <QNetworkReply>
@@ -41,6 +42,8 @@ struct MediaWikiPrivate {
     QList<MediaWiki::Result> results;
     QUrl apiUrl;
     QUrl baseUrl;
+    // the base URLs of the wikis asked before, by API URL
+    QHash<QUrl, QUrl> baseUrls;
     QNetworkAccessManager *manager;
     int maxItems;
     QNetworkReply *reply;
@@ -98,8 +101,22 @@ void MediaWiki::setApiUrl( const QUrl &url )
     if ( d->apiUrl == url )
     return;
 
+    // whatever is running is for the other wiki, the site info included
+    if ( d->reply ) {
+        QNetworkReply *reply = d->reply;
+        d->reply = nullptr;
+        reply->abort();
+    }
+    d->query.clear();
     d->apiUrl = url;
-    d->state = StateApiChanged;
+
+    const auto it = d->baseUrls.constFind( url );
+    if ( it != d->baseUrls.constEnd() ) {
+        d->baseUrl = *it;
+        d->state = StateReady;
+    } else {
+        d->state = StateApiChanged;
+    }
 }
 
 int MediaWiki::timeout() const
@@ -114,11 +131,16 @@ void MediaWiki::setTimeout( int millis )
 
 void MediaWiki::abort()
 {
-    if ( !d->reply )
+    d->query.clear();
+
+    // the site info is asked for once only, so it is worth waiting for
+    if ( !d->reply || d->state == StateApiUpdating )
     return;
 
-    d->reply->abort();
+    // the reply is finished right away, and must not look like the current one then
+    QNetworkReply *reply = d->reply;
     d->reply = nullptr;
+    reply->abort();
 }
 
 void MediaWiki::search( const QString &searchTerm )
@@ -133,17 +155,37 @@ void MediaWiki::search( const QString &searchTerm )
     url.setQuery(urlQuery);
 
     qDebug() << "Constructed search URL" << url;
+    startSearch( url );
+}
 
-    if ( d->state == StateReady ) {
-        QNetworkRequest req(url);
-        req.setRawHeader( QByteArray("User-Agent"), d->userAgent );
-        qDebug() << "mediawiki User-Agent" << req.rawHeader(QByteArray("UserAgent"));
+void MediaWiki::prefixSearch( const QString &prefix )
+{
+    // https://en.wikipedia.org/w/api.php?action=query&list=prefixsearch&pssearch=linu
+    QUrl url = d->apiUrl;
+    QUrlQuery urlQuery(url);
+    urlQuery.addQueryItem(QStringLiteral("action"), QStringLiteral("query"));
+    urlQuery.addQueryItem(QStringLiteral("format"), QStringLiteral("xml"));
+    urlQuery.addQueryItem(QStringLiteral("list"), QStringLiteral("prefixsearch"));
+    urlQuery.addQueryItem(QStringLiteral("pssearch"), prefix );
+    urlQuery.addQueryItem(QStringLiteral("pslimit"), QString::number(d->maxItems));
+    url.setQuery(urlQuery);
 
-        d->reply = d->manager->get( req );
-        QTimer::singleShot( d->timeout, this, SLOT(abort()) );
-    } else if ( d->state == StateApiChanged ) {
+    qDebug() << "Constructed prefix search URL" << url;
+    startSearch( url );
+}
+
+void MediaWiki::startSearch( const QUrl &url )
+{
+    // a search still running is for a term the user moved on from
+    abort();
+
+    if ( d->state == StateReady ) {
+        sendRequest( url );
+    } else {
         d->query = url;
-        findBase();
+        if ( d->state == StateApiChanged ) {
+            findBase();
+        }
     }
 }
 
@@ -158,42 +200,58 @@ void MediaWiki::findBase()
     url.setQuery(urlQuery);
 
     qDebug() << "Constructed base query URL" << url;
+    sendRequest( url );
+    d->state = StateApiUpdating;
+}
+
+void MediaWiki::sendRequest( const QUrl &url )
+{
     QNetworkRequest req(url);
     req.setRawHeader( QByteArray("User-Agent"), d->userAgent );
 
+    // the manager is kept for all queries, so the connection to the wiki is reused
     d->reply = d->manager->get( req );
-    d->state = StateApiUpdating;
+    // bound to the reply, so it cannot abort a later one
+    QTimer::singleShot( d->timeout, d->reply, &QNetworkReply::abort );
 }
 
 void MediaWiki::onNetworkRequestFinished(QNetworkReply *reply)
 {
-    if ( reply->error() != QNetworkReply::NoError ) {
-        qDebug() << "Request failed, " << reply->errorString();
-        reply->deleteLater();
-        d->reply = nullptr;
-        emit finished(false);
-        return;
-    }
+    reply->deleteLater();
 
-    qDebug() << "Request succeeded" << d->apiUrl;
+    // aborted because another search was started
+    if ( reply != d->reply )
+    return;
+
+    d->reply = nullptr;
 
     if ( d->state == StateApiUpdating ) {
-        bool ok = processBaseResult( reply );
-        Q_UNUSED ( ok );
-        reply->deleteLater();
-        reply= nullptr;
+        if ( reply->error() != QNetworkReply::NoError || !processBaseResult( reply ) ) {
+            qDebug() << "Could not get the site info, " << reply->errorString();
+            // asked for again with the next search
+            d->state = StateApiChanged;
+            if ( !d->query.isEmpty() ) {
+                d->query.clear();
+                emit finished(false);
+            }
+            return;
+        }
+        d->baseUrls.insert( d->apiUrl, d->baseUrl );
         d->state = StateReady;
 
-        QNetworkRequest req(d->query);
-        req.setRawHeader( QByteArray("User-Agent"), d->userAgent );
-        d->reply = d->manager->get( req );
-        QTimer::singleShot( d->timeout, this, SLOT(abort()) );
+        // abort() leaves the site info running, but clears the search which was waiting for it
+        if ( !d->query.isEmpty() ) {
+            sendRequest( d->query );
+            d->query.clear();
+        }
+    } else if ( reply->error() != QNetworkReply::NoError ) {
+        qDebug() << "Request failed, " << reply->errorString();
+        emit finished(false);
     } else {
+        qDebug() << "Request succeeded" << d->apiUrl;
         bool ok = processSearchResult( reply );
 
         emit finished( ok );
-        d->reply->deleteLater();
-        d->reply = nullptr;
     }
 }
 
@@ -227,7 +285,8 @@ bool MediaWiki::processSearchResult( QIODevice *source )
         QXmlStreamReader::TokenType tokenType = reader.readNext();
         // qDebug() << "Token" << int(tokenType);
         if ( tokenType == QXmlStreamReader::StartElement ) {
-            if (reader.name() == QLatin1String("p")) {
+            // "ps" for prefix searches
+            if (reader.name() == QLatin1String("p") || reader.name() == QLatin1String("ps")) {
                 QXmlStreamAttributes attrs = reader.attributes();
 
                 Result r;
@@ -236,7 +295,7 @@ bool MediaWiki::processSearchResult( QIODevice *source )
 
                 qDebug() << "Got result: url=" << r.url << "title=" << r.title;
 
-                d->results.prepend( r );
+                d->results.append( r );
             }
         } else if ( tokenType == QXmlStreamReader::Invalid ) {
             return false;
@@ -68,14 +68,15 @@ public:
     /**
      * Create a media wiki querying object with the specified parent. The querying
      * object can be used for multiple queries, though only one can be performed at
-     * a time.
+     * a time. It keeps its connection to the wiki and what it learned about it
+     * between queries, so it is meant to be kept around.
      * @param parent The parent object
      */
     explicit MediaWiki(QObject *parent = nullptr);
     ~MediaWiki() override;
 
     /**
-     * @returns a list of matches.
+     * @returns a list of matches, the best one first.
      */
     QList<MediaWiki::Result> results() const;
 
@@ -119,12 +120,20 @@ Q_SIGNALS:
 
 public Q_SLOTS:
     /**
-     * Search the wiki for the specified search term.
+     * Search the wiki for the specified search term. A search which is still
+     * running is aborted, without finished() being emitted for it.
      */
     void search( const QString &searchTerm );
 
     /**
-     * Aborts the currently running request.
+     * Search the wiki for pages with titles starting with @p prefix, which is
+     * cheaper for the wiki and finds pages by words which are not typed in
+     * completely yet. A search which is still running is aborted, like with search().
+     */
+    void prefixSearch( const QString &prefix );
+
+    /**
+     * Aborts the currently running search, without finished() being emitted.
      */
     void abort();
 
@@ -133,6 +142,8 @@ private Q_SLOTS:
 
 private:
     void findBase();
+    void startSearch( const QUrl &url );
+    void sendRequest( const QUrl &url );
     bool processBaseResult( QIODevice *source );
     bool processSearchResult( QIODevice *source );
 
@@ -26,15 +26,23 @@
 #include <KServiceTypeTrader>
 #include <KLocalizedString>
 // Qt
-#include <QMutex>
-#include <QEventLoop>
-#include <QWaitCondition>
 #include <QDesktopServices>
 #include <QDebug>
+#include <QTimer>
 
+#include <algorithm>
+
+// we don't want to query on every keypress
+static const int debounceInterval = 500;
+// shorter queries are mostly words not typed in completely, which only a prefix search finds
+static const int prefixSearchLength = 6;
+// searches remembered, for backspacing and refining queries
+static const int cacheSize = 50;
+static const qint64 cacheTimeToLive = 10 * 60 * 1000;
 
 MediaWikiRunner::MediaWikiRunner(QObject *parent, const QVariantList &args)
-    : Plasma::AbstractRunner(parent, args)
+    : Plasma::AbstractRunner(parent, args),
+      m_cache(cacheSize)
 {
     setObjectName(QStringLiteral("MediaWikiRunner"));
 
@@ -59,6 +67,17 @@ MediaWikiRunner::MediaWikiRunner(QObject *parent, const QVariantList &args)
     addSyntax(Plasma::RunnerSyntax(QStringLiteral("wiki :q:"), i18n("Searches %1 for :q:.", m_name)));
 
     setSpeed( SlowSpeed );
+
+    m_mediaWiki = new MediaWiki(this);
+    m_mediaWiki->setApiUrl(m_apiUrl);
+    connect(m_mediaWiki, &MediaWiki::finished, this, &MediaWikiRunner::searchFinished);
+
+    m_debounceTimer = new QTimer(this);
+    m_debounceTimer->setSingleShot(true);
+    m_debounceTimer->setInterval(debounceInterval);
+    connect(m_debounceTimer, &QTimer::timeout, this, &MediaWikiRunner::sendQuery);
+
+    connect(this, &Plasma::AbstractRunner::teardown, this, &MediaWikiRunner::cancelQueries);
 }
 
 MediaWikiRunner::~MediaWikiRunner()
@@ -89,39 +108,95 @@ void MediaWikiRunner::match(Plasma::RunnerContext &context)
         return;
     }
 
-    QEventLoop loop;
-    // Wait a second, we don't want to  query on every keypress
-    QMutex mutex;
-    QWaitCondition waiter;
-    mutex.lock();
-    waiter.wait(&mutex, 1000);
-    mutex.unlock();
+    Query query;
+    query.term = term.simplified();
+    query.key = query.term.toCaseFolded();
+    query.maxItems = context.singleRunnerQueryMode() ? 10 : 3;
+    // copies become invalid as soon as the query changes, so the
+    // results of a query the user moved on from never show up
+    query.context = context;
 
-    if (!context.isValid()) {
-        return;
+    QList<MediaWiki::Result> results;
+    const bool complete = cachedResults(query, &results);
+    for (const MediaWiki::Result &result : qAsConst(results)) {
+        query.shownTitles.insert(result.title);
     }
+    context.addMatches(matchesForResults(results));
 
-    MediaWiki mediawiki;
-    if (context.singleRunnerQueryMode()) {
-        mediawiki.setMaxItems(10);
-    } else {
-        mediawiki.setMaxItems(3);
+    {
+        QMutexLocker locker(&m_pendingQueryMutex);
+        if (complete) {
+            m_pendingQuery = Query();
+        } else {
+            m_pendingQuery = query;
+        }
     }
-    mediawiki.setApiUrl( m_apiUrl );
-    connect(&mediawiki, &MediaWiki::finished, &loop, &QEventLoop::quit);
 
-    mediawiki.search(term);
-    qDebug() << "Wikisearch:" << m_name << term;
+    // rather than blocking this thread, the matches are added when the wiki answers
+    QMetaObject::invokeMethod(this, &MediaWikiRunner::cancelSupersededQuery, Qt::QueuedConnection);
+    if (!complete) {
+        // restarted with every keypress, so only the last query of a burst is sent
+        QMetaObject::invokeMethod(m_debounceTimer, "start", Qt::QueuedConnection);
+    }
+}
 
-    loop.exec();
+bool MediaWikiRunner::cachedResults(const Query &query, QList<MediaWiki::Result> *results)
+{
+    QMutexLocker locker(&m_cacheMutex);
 
-    if (!context.isValid()) {
-        return;
+    // backspacing, or the same query again
+    if (const CachedResults *cached = cachedSearch(query.key)) {
+        if (cached->maxItems >= query.maxItems) {
+            // the best results are first, like the wiki would have answered
+            *results = cached->results.mid(0, query.maxItems);
+            return true;
+        }
+    }
+
+    // refining a query: the results of the longest cached query it starts with,
+    // which are shown until the wiki answered, if they still match
+    const QVector<QStringRef> words = query.key.splitRef(QLatin1Char(' '));
+    for (int length = query.key.length() - 1; length >= 3; --length) {
+        const CachedResults *cached = cachedSearch(query.key.left(length));
+        if (!cached) {
+            continue;
+        }
+        for (const MediaWiki::Result &result : cached->results) {
+            const QString title = result.title.toCaseFolded();
+            const bool matches = std::all_of(words.constBegin(), words.constEnd(), [&title](const QStringRef &word) {
+                return title.contains(word);
+            });
+            if (matches) {
+                results->append(result);
+                if (results->count() == query.maxItems) {
+                    break;
+                }
+            }
+        }
+        break;
+    }
+    return false;
+}
+
+const MediaWikiRunner::CachedResults *MediaWikiRunner::cachedSearch(const QString &key)
+{
+    const CachedResults *cached = m_cache.object(key);
+    if (cached && cached->age.hasExpired(cacheTimeToLive)) {
+        m_cache.remove(key);
+        return nullptr;
     }
+    return cached;
+}
+
+QList<Plasma::QueryMatch> MediaWikiRunner::matchesForResults(const QList<MediaWiki::Result> &results)
+{
     qreal relevance = 0.5;
     qreal stepRelevance = 0.1;
 
-    foreach(const MediaWiki::Result& res, mediawiki.results()) {
+    // the best result gets the highest relevance
+    QList<Plasma::QueryMatch> matches;
+    for (auto it = results.crbegin(); it != results.crend(); ++it) {
+        const MediaWiki::Result &res = *it;
         qDebug() << "Match:" << res.url << res.title;
         Plasma::QueryMatch match(this);
         match.setType(Plasma::QueryMatch::PossibleMatch);
@@ -131,8 +206,103 @@ void MediaWikiRunner::match(Plasma::RunnerContext &context)
         match.setRelevance(relevance);
         relevance +=stepRelevance;
         stepRelevance *=0.5;
-        context.addMatch(match);
+        matches.append(match);
+    }
+    return matches;
+}
+
+void MediaWikiRunner::sendQuery()
+{
+    Query query;
+    {
+        QMutexLocker locker(&m_pendingQueryMutex);
+        // RunnerContext cannot be moved or swapped, only assigned
+        query = m_pendingQuery;
+        m_pendingQuery = Query();
+    }
+
+    if (query.term.isEmpty() || !query.context.isValid()) {
+        return;
+    }
+
+    // the same query matched again, its answer is on its way already
+    if (query.key == m_runningQuery.key && query.maxItems == m_runningQuery.maxItems) {
+        m_runningQuery.context = query.context;
+        m_runningQuery.shownTitles = query.shownTitles;
+        return;
+    }
+
+    m_runningQuery = query;
+    m_mediaWiki->setMaxItems(query.maxItems);
+    if (query.term.length() < prefixSearchLength) {
+        m_mediaWiki->prefixSearch(query.term);
+    } else {
+        m_mediaWiki->search(query.term);
+    }
+    qDebug() << "Wikisearch:" << m_name << query.term;
+}
+
+void MediaWikiRunner::cancelSupersededQuery()
+{
+    if (m_runningQuery.key.isEmpty()) {
+        return;
+    }
+
+    QString pendingKey;
+    {
+        QMutexLocker locker(&m_pendingQueryMutex);
+        pendingKey = m_pendingQuery.key;
+    }
+
+    if (pendingKey != m_runningQuery.key) {
+        m_mediaWiki->abort();
+        m_runningQuery = Query();
+    }
+}
+
+void MediaWikiRunner::cancelQueries()
+{
+    m_debounceTimer->stop();
+    {
+        QMutexLocker locker(&m_pendingQueryMutex);
+        m_pendingQuery = Query();
+    }
+    m_mediaWiki->abort();
+    m_runningQuery = Query();
+}
+
+void MediaWikiRunner::searchFinished(bool success)
+{
+    Query query;
+    query = m_runningQuery;
+    m_runningQuery = Query();
+
+    if (!success || query.key.isEmpty()) {
+        return;
+    }
+
+    const QList<MediaWiki::Result> results = m_mediaWiki->results();
+    {
+        QMutexLocker locker(&m_cacheMutex);
+        auto *cached = new CachedResults;
+        cached->results = results;
+        cached->maxItems = query.maxItems;
+        cached->age.start();
+        m_cache.insert(query.key, cached);
+    }
+
+    if (!query.context.isValid()) {
+        return;
+    }
+
+    // those found in the cache while waiting are shown already
+    QList<MediaWiki::Result> newResults;
+    for (const MediaWiki::Result &result : results) {
+        if (!query.shownTitles.contains(result.title)) {
+            newResults.append(result);
+        }
     }
+    query.context.addMatches(matchesForResults(newResults));
 }
 
 void MediaWikiRunner::run(const Plasma::RunnerContext &context, const Plasma::QueryMatch &match)
@@ -22,9 +22,16 @@
 
 // KF
 #include <KRunner/AbstractRunner>
+#include "mediawiki.h"
+
 // Qt
+#include <QCache>
+#include <QElapsedTimer>
+#include <QMutex>
 #include <QNetworkConfigurationManager>
+#include <QSet>
 
+class QTimer;
 
 class MediaWikiRunner : public Plasma::AbstractRunner
 {
@@ -38,12 +45,56 @@ public:
     void run(const Plasma::RunnerContext &context, const Plasma::QueryMatch &match) override;
 
 private:
+    struct Query {
+        QString term;
+        // the term as the results are cached by
+        QString key;
+        int maxItems = 0;
+        Plasma::RunnerContext context;
+        // the titles of the cached results added to the context already
+        QSet<QString> shownTitles;
+    };
+
+    struct CachedResults {
+        QList<MediaWiki::Result> results;
+        int maxItems;
+        QElapsedTimer age;
+    };
+
+    /**
+     * Sets @p results to the cached results of @p query, and returns true if
+     * these are all of them. Otherwise they are the cached results of a shorter
+     * query which match @p query as well, and the wiki has to be asked.
+     */
+    bool cachedResults(const Query &query, QList<MediaWiki::Result> *results);
+    const CachedResults *cachedSearch(const QString &key);
+    QList<Plasma::QueryMatch> matchesForResults(const QList<MediaWiki::Result> &results);
+
+    void sendQuery();
+    void cancelSupersededQuery();
+    void cancelQueries();
+    void searchFinished(bool success);
+
     QString m_iconName;
     QString m_name;
     QString m_comment;
     QUrl m_apiUrl;
 
     QNetworkConfigurationManager m_networkConfigurationManager;
+
+    // lives in the thread of the runner, like the members below
+    MediaWiki *m_mediaWiki;
+    QTimer *m_debounceTimer;
+    // sent to the wiki, or empty
+    Query m_runningQuery;
+
+    // the last query matched, waiting for the user to stop typing
+    QMutex m_pendingQueryMutex;
+    Query m_pendingQuery;
+
+    // the results of the last searches of this wiki, by query
+    QMutex m_cacheMutex;
+    QCache<QString, CachedResults> m_cache;
 };
 
 #endif
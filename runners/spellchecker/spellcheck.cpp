@@ -25,17 +25,60 @@
 #include <QSet>
 #include <QIcon>
 #include <QMimeData>
+#include <QTimer>
 
 #include <KLocalizedString>
 
+#include <algorithm>
+
 namespace {
 namespace ActionIds {
 inline QString copyToClipboard() { return QStringLiteral("copyToClipboard"); }
 }
+
+//Loading a dictionary takes long, so spellers are kept until they were not used for this long
+const int spellerIdleTime = 10 * 60 * 1000;
+//Words checked, with their suggestions
+const int verdictCacheSize = 256;
+
+bool isWordJoiner(QChar c)
+{
+    return c == QLatin1Char('\'') || c == QChar(0x2019) || c == QLatin1Char('-');
+}
+
+//The words of text, with apostrophes and hyphens inside of words like "don't"
+//and "well-known" as part of them. Everything else separates words.
+QVector<QStringRef> splitWords(const QString &text)
+{
+    QVector<QStringRef> words;
+    int start = -1;
+    for (int i = 0; i <= text.size(); ++i) {
+        bool inWord = false;
+        if (i < text.size()) {
+            const QChar c = text.at(i);
+            inWord = c.isLetterOrNumber() || c.isMark()
+                || (start >= 0 && isWordJoiner(c) && i + 1 < text.size() && text.at(i + 1).isLetter());
+        }
+        if (inWord && start < 0) {
+            start = i;
+        } else if (!inWord && start >= 0) {
+            words.append(text.midRef(start, i - start));
+            start = -1;
+        }
+    }
+    return words;
+}
+
+bool containsNumber(const QStringRef &word)
+{
+    return std::any_of(word.cbegin(), word.cend(), [](QChar c) { return c.isNumber(); });
+}
 }
 
 SpellCheckRunner::SpellCheckRunner(QObject* parent, const QVariantList &args)
-    : Plasma::AbstractRunner(parent, args)
+    : Plasma::AbstractRunner(parent, args),
+      m_languagesLoaded(false),
+      m_verdicts(verdictCacheSize)
 {
     Q_UNUSED(args)
     setObjectName(QLatin1String( "Spell Checker" ));
@@ -43,6 +86,11 @@ SpellCheckRunner::SpellCheckRunner(QObject* parent, const QVariantList &args)
     setSpeed(AbstractRunner::SlowSpeed);
 
     addAction(ActionIds::copyToClipboard(), QIcon::fromTheme(QStringLiteral("edit-copy")), i18nc("@action", "Copy to Clipboard"));
+
+    m_expiryTimer = new QTimer(this);
+    m_expiryTimer->setSingleShot(true);
+    m_expiryTimer->setInterval(spellerIdleTime);
+    connect(m_expiryTimer, &QTimer::timeout, this, &SpellCheckRunner::expireSpellers);
 }
 
 SpellCheckRunner::~SpellCheckRunner()
@@ -55,22 +103,31 @@ void SpellCheckRunner::init()
 
     //Connect prepare and teardown signals
     connect(this, SIGNAL(prepare()), this, SLOT(loaddata()));
-    connect(this, SIGNAL(teardown()), this, SLOT(destroydata()));
+    connect(this, SIGNAL(teardown()), m_expiryTimer, SLOT(start()));
 }
 
 //Load a default dictionary and some locale names
 void SpellCheckRunner::loaddata()
 {
     //Load the default speller, with the default language
-    auto defaultSpellerIt = m_spellers.find(QString());
-    if (defaultSpellerIt == m_spellers.end()) {
-        defaultSpellerIt = m_spellers.insert(QString(), QSharedPointer<Sonnet::Speller> (new Sonnet::Speller(QString())));
+    const QSharedPointer<Sonnet::Speller> defaultSpeller = speller(QString());
+
+    QMutexLocker lock(&m_spellLock);
+    //The languages are looked up once, and again only after the default speller expired
+    if (m_languagesLoaded) {
+        return;
     }
-    auto& defaultSpeller = defaultSpellerIt.value();
+    m_languagesLoaded = true;
+    m_languages.clear();
+    m_languageCodeParts.clear();
 
     //store all language names, makes it possible to type "spell german TERM" if english locale is set
     //Need to construct a map between natual language names and names the spell-check recognises.
     const QStringList avail = defaultSpeller->availableLanguages();
+    m_availableLanguages.clear();
+    foreach (const QString &code, avail) {
+        m_availableLanguages.insert(code);
+    }
     //We need to filter the available languages so that we associate the natural language
     //name (eg. 'german') with one sub-code.
     QSet<QString> families;
@@ -100,21 +157,88 @@ void SpellCheckRunner::loaddata()
             //Otherwise, pick the first value as it is highest priority.
             code = family.first();
         }
-        //Finally, add code to the map.
-        // FIXME: We need someway to map languageCodeToName
-        const QString name;// = locale->languageCodeToName(fcode);
-        if (!name.isEmpty()) {
-            m_languages[name.toLower()] = code;
+        //Finally, add code to the map, by its english and its native name.
+        const QLocale locale(fcode);
+        if (code.isEmpty() || locale.language() == QLocale::C) {
+            continue;
+        }
+        m_languages[QLocale::languageToString(locale.language()).toLower()] = code;
+        const QString nativeName = locale.nativeLanguageName();
+        if (!nativeName.isEmpty()) {
+            m_languages[nativeName.toLower()] = code;
         }
-//         kDebug() << "SPELL lang: " << fcode<< "::"<< name << "  :  " << code;
     }
 
+    //Every part of a code, so that "de" finds "de_DE" without searching all of them
+    foreach (const QString &code, m_languages) {
+        for (int from = 0; from < code.size(); ++from) {
+            for (int length = 1; from + length <= code.size(); ++length) {
+                const QString part = code.mid(from, length);
+                if (!m_languageCodeParts.contains(part)) {
+                    m_languageCodeParts.insert(part, code);
+                }
+            }
+        }
+    }
+}
+
+void SpellCheckRunner::expireSpellers()
+{
+    QMutexLocker lock(&m_spellLock);
+    for (auto it = m_spellers.begin(); it != m_spellers.end();) {
+        if (it->lastUsed.hasExpired(spellerIdleTime)) {
+            //Languages may have been installed or removed meanwhile
+            if (it.key().isEmpty()) {
+                m_languagesLoaded = false;
+            }
+            it = m_spellers.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+QSharedPointer<Sonnet::Speller> SpellCheckRunner::speller(const QString &language)
+{
+    QMutexLocker lock(&m_spellLock);
+    PooledSpeller &pooled = m_spellers[language];
+    if (!pooled.speller) {
+        pooled.speller = QSharedPointer<Sonnet::Speller>(new Sonnet::Speller(language));
+    }
+    pooled.lastUsed.start();
+    return pooled.speller;
 }
 
-void SpellCheckRunner::destroydata()
+QVector<SpellCheckRunner::Verdict> SpellCheckRunner::check(const QSharedPointer<Sonnet::Speller> &speller, const QStringList &words)
 {
-    //Clear the data arrays to save memory
-    m_spellers.clear();
+    const QString prefix = speller->language() + QLatin1Char('\n');
+    QVector<Verdict> verdicts(words.count());
+    QVector<int> unchecked;
+    {
+        //While typing, only the last word is new
+        QMutexLocker lock(&m_spellLock);
+        for (int i = 0; i < words.count(); ++i) {
+            if (const Verdict *verdict = m_verdicts.object(prefix + words.at(i))) {
+                verdicts[i] = *verdict;
+            } else {
+                unchecked.append(i);
+            }
+        }
+    }
+
+    if (unchecked.isEmpty()) {
+        return verdicts;
+    }
+
+    for (int i : qAsConst(unchecked)) {
+        verdicts[i].correct = speller->checkAndSuggest(words.at(i), verdicts[i].suggestions);
+    }
+
+    QMutexLocker lock(&m_spellLock);
+    for (int i : qAsConst(unchecked)) {
+        m_verdicts.insert(prefix + words.at(i), new Verdict(verdicts.at(i)));
+    }
+    return verdicts;
 }
 
 void SpellCheckRunner::reloadConfiguration()
@@ -142,37 +266,24 @@ void SpellCheckRunner::reloadConfiguration()
  * Return the empty string if we can't match a language. */
 QString SpellCheckRunner::findlang(const QStringList& terms)
 {
-    auto defaultSpeller = m_spellers[QString()];
+    QMutexLocker lock(&m_spellLock);
     //If first term is a language code (like en_GB), set it as the spell-check language
-    if (terms.count() >= 1 && defaultSpeller->availableLanguages().contains(terms[0])) {
+    if (terms.count() >= 1 && m_availableLanguages.contains(terms[0])) {
         return terms[0];
     }
     //If we have two terms and the first is a language name (eg 'french'),
     //set it as the available language
     else if (terms.count() >=2) {
-        QString code;
-        {
-            //Is this a descriptive language name?
-            QMap<QString, QString>::const_iterator it = m_languages.constFind(terms[0].toLower());
-            if (it != m_languages.constEnd()) {
-                code = *it;
-            }
-            //Maybe it is a subset of a language code?
-            else {
-                QStringList codes = QStringList(m_languages.values()).filter(terms[0]);
-                if (!codes.isEmpty()) {
-                    code = codes.first();
-                }
-            }
+        //Is this a descriptive language name?
+        QString code = m_languages.value(terms[0].toLower());
+        //Maybe it is a subset of a language code?
+        if (code.isEmpty()) {
+            code = m_languageCodeParts.value(terms[0]);
         }
 
-        if (!code.isEmpty()) {
-            //We found a valid language! Check still available
-            const QStringList avail = defaultSpeller->availableLanguages();
-            //Does the spell-checker like it?
-            if (avail.contains(code)) {
-                return code;
-            }
+        //We found a valid language! Does the spell-checker like it?
+        if (!code.isEmpty() && m_availableLanguages.contains(code)) {
+            return code;
         }
         //FIXME: Support things like 'british english' or 'canadian french'
     }
@@ -196,62 +307,115 @@ void SpellCheckRunner::match(Plasma::RunnerContext &context)
         query = query.mid(len).trimmed();
     }
 
-    //Pointer to speller object with our chosen language
-    QSharedPointer<Sonnet::Speller> speller = m_spellers[QString()];
-
-    if (speller->isValid()) {
-        QStringList terms = query.split(QLatin1Char(' '), QString::SkipEmptyParts);
-        QString lang = findlang(terms);
-        //If we found a language, create a new speller object using it.
-        if (!lang.isEmpty()) {
-            //First term is the language
-            terms.removeFirst();
-            //New speller object if we don't already have one
-            if (!m_spellers.contains(lang)) {
-                QMutexLocker lock (&m_spellLock);
-                //Check nothing happened while we were acquiring the lock
-                if (!m_spellers.contains(lang)) {
-                    m_spellers[lang] = QSharedPointer<Sonnet::Speller>(new Sonnet::Speller(lang));
-                }
-            }
-            speller = m_spellers[lang];
-            //Rejoin the strings
-            query = terms.join(QLatin1String(" "));
-        }
+    QStringList terms = query.split(QLatin1Char(' '), QString::SkipEmptyParts);
+    const QString lang = findlang(terms);
+    //Pointer to speller object with our chosen language, from the pool
+    QSharedPointer<Sonnet::Speller> speller = SpellCheckRunner::speller(lang);
+    //If we found a language, the first term is the language
+    if (!lang.isEmpty()) {
+        terms.removeFirst();
+        //Rejoin the strings
+        query = terms.join(QLatin1String(" "));
     }
 
     if (query.size() < 2) {
         return;
     }
 
-    if (speller->isValid()) {
-        QStringList suggestions;
-        const bool correct = speller->checkAndSuggest(query,suggestions);
-        if (correct) {
-            Plasma::QueryMatch match(this);
-            match.setType(Plasma::QueryMatch::InformationalMatch);
-            match.setIconName(QStringLiteral("checkbox"));
-            match.setText(query);
-            match.setSubtext(i18nc("Term is spelled correctly", "Correct"));
-            match.setData(query);
-            context.addMatch(match);
-        } else {
-            for (const auto& suggestion : qAsConst(suggestions)) {
-                Plasma::QueryMatch match(this);
-                match.setType(Plasma::QueryMatch::InformationalMatch);
-                match.setIconName(QStringLiteral("edit-rename"));
-                match.setText(suggestion);
-                match.setSubtext(i18n("Suggested term"));
-                match.setData(suggestion);
-                context.addMatch(match);
-            }
-        }
-    } else {
+    if (!speller->isValid()) {
         Plasma::QueryMatch match(this);
         match.setType(Plasma::QueryMatch::InformationalMatch);
         match.setIconName(QStringLiteral("task-attention"));
         match.setText(i18n("Could not find a dictionary."));
         context.addMatch(match);
+        return;
+    }
+
+    auto addMatch = [this, &context](const QString &text, const QString &iconName, const QString &subtext, qreal relevance) {
+        Plasma::QueryMatch match(this);
+        match.setType(Plasma::QueryMatch::InformationalMatch);
+        match.setIconName(iconName);
+        match.setText(text);
+        match.setSubtext(subtext);
+        match.setData(text);
+        match.setRelevance(relevance);
+        context.addMatch(match);
+    };
+
+    //Numbers are left alone, everything else is checked word by word
+    QVector<QStringRef> words = splitWords(query);
+    words.erase(std::remove_if(words.begin(), words.end(), containsNumber), words.end());
+    if (words.count() < 2) {
+        //A single word, with whatever the user typed around it
+        const Verdict verdict = check(speller, {query}).first();
+        if (verdict.correct) {
+            addMatch(query, QStringLiteral("checkbox"), i18nc("Term is spelled correctly", "Correct"), 0.7);
+        } else {
+            qreal relevance = 0.7;
+            for (const auto& suggestion : verdict.suggestions) {
+                addMatch(suggestion, QStringLiteral("edit-rename"), i18n("Suggested term"), relevance);
+                relevance *= 0.99;
+            }
+        }
+        return;
+    }
+
+    QStringList wordList;
+    wordList.reserve(words.count());
+    for (const QStringRef &word : qAsConst(words)) {
+        wordList.append(word.toString());
+    }
+    const QVector<Verdict> verdicts = check(speller, wordList);
+
+    QVector<int> misspelled;
+    for (int i = 0; i < verdicts.count(); ++i) {
+        if (!verdicts.at(i).correct) {
+            misspelled.append(i);
+        }
+    }
+    if (misspelled.isEmpty()) {
+        addMatch(query, QStringLiteral("checkbox"), i18nc("Term is spelled correctly", "Correct"), 0.7);
+        return;
+    }
+
+    //The query with each misspelled word replaced by its first suggestion,
+    //or by the given one for the word at index
+    auto phrase = [&](int index, const QString &replacement) {
+        QString result;
+        result.reserve(query.size() + 16);
+        int end = 0;
+        for (int i : qAsConst(misspelled)) {
+            const QStringRef &word = words.at(i);
+            const QStringList &suggestions = verdicts.at(i).suggestions;
+            result += query.midRef(end, word.position() - end);
+            if (i == index) {
+                result += replacement;
+            } else if (!suggestions.isEmpty()) {
+                result += suggestions.first();
+            } else {
+                result += word;
+            }
+            end = word.position() + word.size();
+        }
+        result += query.midRef(end);
+        return result;
+    };
+
+    const QString corrected = phrase(-1, QString());
+    if (corrected == query) {
+        //None of the misspelled words has a suggestion
+        return;
+    }
+    addMatch(corrected, QStringLiteral("edit-rename"), i18n("Suggested correction"), 1.0);
+
+    //The other suggestions for each misspelled word, in the corrected phrase
+    qreal relevance = 0.7;
+    for (int i : qAsConst(misspelled)) {
+        const QStringList &suggestions = verdicts.at(i).suggestions;
+        for (int j = 1; j < suggestions.count(); ++j) {
+            addMatch(phrase(i, suggestions.at(j)), QStringLiteral("edit-rename"), i18n("Suggested term"), relevance);
+            relevance *= 0.99;
+        }
     }
 }
 
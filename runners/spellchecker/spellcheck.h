@@ -22,8 +22,15 @@
 #include <sonnet/speller.h>
 
 #include <KRunner/AbstractRunner>
+#include <QCache>
+#include <QElapsedTimer>
+#include <QHash>
 #include <QMutex>
+#include <QSet>
 #include <QSharedPointer>
+#include <QVector>
+
+class QTimer;
 
 /**
  * This checks the spelling of query
@@ -47,16 +54,34 @@ protected Q_SLOTS:
     QMimeData * mimeDataForMatch(const Plasma::QueryMatch &match) override;
 
     void loaddata();
-    void destroydata();
+    void expireSpellers();
 
 private:
+    struct PooledSpeller {
+        QSharedPointer<Sonnet::Speller> speller;
+        QElapsedTimer lastUsed;
+    };
+
+    struct Verdict {
+        bool correct = false;
+        QStringList suggestions;
+    };
+
     QString findlang(const QStringList &terms);
+    QSharedPointer<Sonnet::Speller> speller(const QString &language);
+    //Returns whether each of words is spelled correctly, with suggestions if not
+    QVector<Verdict> check(const QSharedPointer<Sonnet::Speller> &speller, const QStringList &words);
 
     QString m_triggerWord;
     QMap<QString, QString> m_languages;//key=language name, value=language code
+    QHash<QString, QString> m_languageCodeParts; //key=any part of a code in m_languages, value=that code
+    QSet<QString> m_availableLanguages;
+    bool m_languagesLoaded;
     bool m_requireTriggerWord;
-    QMap<QString, QSharedPointer<Sonnet::Speller> > m_spellers; //spellers
-    QMutex m_spellLock; //Lock held when constructing a new speller
+    QHash<QString, PooledSpeller> m_spellers; //key=language code, empty for the default language
+    QCache<QString, Verdict> m_verdicts; //key=language code and word
+    QTimer *m_expiryTimer; //started when KRunner is closed, drops the spellers not used since
+    QMutex m_spellLock; //Lock held when accessing the languages, the spellers or the verdicts
 };
 
 #endif
@@ -19,63 +19,42 @@
 
 #include "%{APPNAMELC}.h"
 
+#include <plasma/potdprovider/potdparser.h>
+
+// Qt
+#include <QUrl>
+
 // KF
 #include <KPluginFactory>
-#include <KIO/Job>
 
 
 %{APPNAME}::%{APPNAME}(QObject *parent, const QVariantList &args)
     : PotdProvider(parent, args)
 {
-    // TODO: replace with url to data about what the current picture of the day is
-    const QUrl potdFeed(QStringLiteral("https://kde.org"));
-
-    KIO::StoredTransferJob* job = KIO::storedGet(potdFeed, KIO::NoReload, KIO::HideProgressInfo);
-    connect(job, &KIO::StoredTransferJob::finished,
-            this, &%{APPNAME}::handleFinishedFeedRequest);
-}
-
-%{APPNAME}::~%{APPNAME}()
-{
+    // Fetches the page, then the image at the url returned by imageUrl().
+    // Timeouts, retries and writing the image to the cache are taken care of,
+    // finished() or error() are emitted at the end.
+    fetchPage(feedUrl(), &%{APPNAME}::imageUrl);
 }
 
-QImage %{APPNAME}::image() const
-{
-    return mImage;
-}
+%{APPNAME}::~%{APPNAME}() = default;
 
-void %{APPNAME}::handleFinishedFeedRequest(KJob *job)
+QUrl %{APPNAME}::feedUrl()
 {
-    KIO::StoredTransferJob *requestJob = static_cast<KIO::StoredTransferJob*>(job);
-    if (requestJob->error()) {
-        emit error(this);
-        return;
-    }
-
-    // TODO: read url to image from requestJob->data()
-    const QUrl picureUrl(QStringLiteral("https://techbase.kde.org/favicon.png"));
-
-    KIO::StoredTransferJob *imageJob = KIO::storedGet(picureUrl, KIO::NoReload, KIO::HideProgressInfo);
-    connect(imageJob, &KIO::StoredTransferJob::finished,
-            this, &%{APPNAME}::handleFinishedImageRequest);
+    // TODO: replace with url to data about what the current picture of the day is
+    return QUrl(QStringLiteral("https://kde.org"));
 }
 
-void %{APPNAME}::handleFinishedImageRequest(KJob *job)
+QUrl %{APPNAME}::imageUrl(const QByteArray &page)
 {
-    KIO::StoredTransferJob *requestJob = static_cast<KIO::StoredTransferJob*>(job);
-    if (requestJob->error()) {
-        emit error(this);
-        return;
-    }
-
-    mImage = QImage::fromData(requestJob->data());
-
-    if (mImage.isNull()) {
-        emit error(this);
-        return;
+    // TODO: read url to image from page, the helpers in potdparser.h
+    // do so without converting or copying it
+    const QByteArray url = PotdParser::textBetween(page, "<meta property=\"og:image\" content=\"", "\"");
+    if (url.isEmpty()) {
+        return QUrl();
     }
 
-    emit finished(this);
+    return QUrl(QString::fromUtf8(url));
 }
 
 
@@ -21,10 +21,6 @@
 #define %{APPNAMEUC}_H
 
 #include <plasma/potdprovider/potdprovider.h>
-// Qt
-#include <QImage>
-
-class KJob;
 
 class %{APPNAME} : public PotdProvider
 {
@@ -45,16 +41,15 @@ public:
     ~%{APPNAME}() override;
 
     /**
-     * Returns the requested image.
+     * Returns the url of the page which names the current picture of the day.
      */
-    QImage image() const override;
-
-private:
-    void handleFinishedFeedRequest(KJob *job);
-    void handleFinishedImageRequest(KJob *job);
+    static QUrl feedUrl();
 
-private:
-    QImage mImage;
+    /**
+     * Returns the url of the image named by @p page, the data at feedUrl(),
+     * or an invalid url if there is none.
+     */
+    static QUrl imageUrl(const QByteArray &page);
 };
 
 #endif
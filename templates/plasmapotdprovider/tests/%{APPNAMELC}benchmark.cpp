@@ -0,0 +1,54 @@
+/*
+ *   Copyright (C) %{CURRENT_YEAR} by %{AUTHOR} <%{EMAIL}>                      *
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details
+ *
+ *   You should have received a copy of the GNU Library General Public
+ *   License along with this program; if not, write to the
+ *   Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "%{APPNAMELC}.h"
+
+// Qt
+#include <QFile>
+#include <QTest>
+#include <QUrl>
+
+/**
+ * Measures how long reading the image url out of the canned page in data/ takes,
+ * which is the only part of the provider which runs on the main thread.
+ */
+class %{APPNAME}Benchmark : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void imageUrl();
+};
+
+void %{APPNAME}Benchmark::imageUrl()
+{
+    QFile file(QFINDTESTDATA("data/page.html"));
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    const QByteArray page = file.readAll();
+
+    QUrl url;
+    QBENCHMARK {
+        url = %{APPNAME}::imageUrl(page);
+    }
+    QVERIFY(url.isValid());
+}
+
+QTEST_MAIN(%{APPNAME}Benchmark)
+
+#include "%{APPNAMELC}benchmark.moc"
@@ -0,0 +1,103 @@
+/*
+ *   Copyright (C) %{CURRENT_YEAR} by %{AUTHOR} <%{EMAIL}>                      *
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details
+ *
+ *   You should have received a copy of the GNU Library General Public
+ *   License along with this program; if not, write to the
+ *   Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "%{APPNAMELC}.h"
+
+// Qt
+#include <QBuffer>
+#include <QCryptographicHash>
+#include <QFile>
+#include <QImage>
+#include <QSignalSpy>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QTest>
+#include <QUrl>
+
+/**
+ * Runs the provider against the canned page in data/ instead of the website.
+ * The transfers are replayed from fixtures, like with PLASMA_POTD_REPLAY_DIR.
+ */
+class %{APPNAME}Test : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void parsesThePage();
+    void fetchesTheImage();
+
+private:
+    void addFixture(const QUrl &url, const QByteArray &data);
+
+    QTemporaryDir m_fixtures;
+    QByteArray m_page;
+};
+
+void %{APPNAME}Test::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+    QVERIFY(m_fixtures.isValid());
+    // read by the provider when it is created
+    qputenv("PLASMA_POTD_REPLAY_DIR", QFile::encodeName(m_fixtures.path()));
+
+    QFile page(QFINDTESTDATA("data/page.html"));
+    QVERIFY(page.open(QIODevice::ReadOnly));
+    m_page = page.readAll();
+}
+
+void %{APPNAME}Test::addFixture(const QUrl &url, const QByteArray &data)
+{
+    // fixtures are named after the SHA-1 of the url of their transfer
+    QFile file(m_fixtures.filePath(QString::fromLatin1(QCryptographicHash::hash(url.toEncoded(), QCryptographicHash::Sha1).toHex())));
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    QCOMPARE(file.write(data), qint64(data.size()));
+}
+
+void %{APPNAME}Test::parsesThePage()
+{
+    // TODO: replace with the url of the image on the page in data/
+    QCOMPARE(%{APPNAME}::imageUrl(m_page), QUrl(QStringLiteral("https://kde.org/images/potd.png")));
+    QVERIFY(!%{APPNAME}::imageUrl(QByteArray("<html></html>")).isValid());
+}
+
+void %{APPNAME}Test::fetchesTheImage()
+{
+    QImage image(16, 9, QImage::Format_RGB32);
+    image.fill(Qt::darkBlue);
+    QByteArray imageData;
+    QBuffer buffer(&imageData);
+    buffer.open(QIODevice::WriteOnly);
+    QVERIFY(image.save(&buffer, "PNG"));
+
+    addFixture(%{APPNAME}::feedUrl(), m_page);
+    addFixture(%{APPNAME}::imageUrl(m_page), imageData);
+
+    %{APPNAME} provider(nullptr, { QStringLiteral("%{APPNAMELC}") });
+    QSignalSpy finished(&provider, &PotdProvider::finished);
+    QSignalSpy error(&provider, &PotdProvider::error);
+
+    QTRY_VERIFY(!finished.isEmpty() || !error.isEmpty());
+    QCOMPARE(finished.count(), 1);
+    QCOMPARE(provider.image().size(), image.size());
+}
+
+QTEST_MAIN(%{APPNAME}Test)
+
+#include "%{APPNAMELC}test.moc"
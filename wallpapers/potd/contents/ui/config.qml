@@ -31,6 +31,7 @@ Kirigami.FormLayout {
     property string cfg_Category
     property int cfg_FillMode
     property alias cfg_Color: colorButton.color
+    property alias cfg_Blur: blurCheckBox.checked
     property alias formLayout: root
 
     ListModel {
@@ -238,6 +239,12 @@ Kirigami.FormLayout {
         }
     }
 
+    QQC2.CheckBox {
+        id: blurCheckBox
+        enabled: cfg_FillMode === Image.PreserveAspectFit || cfg_FillMode === Image.Pad
+        text: i18ndc("plasma_wallpaper_org.kde.potd", "@option:check", "Blur the background")
+    }
+
     KQC2.ColorButton {
         id: colorButton
         Kirigami.FormData.label: i18ndc("plasma_wallpaper_org.kde.potd", "@label:chooser", "Background color:")
@@ -27,11 +27,15 @@ Rectangle {
     readonly property string provider: wallpaper.configuration.Provider
     readonly property string category: wallpaper.configuration.Category
     readonly property string identifier: provider === 'unsplash' && category ? provider + ':' + category : provider
+    // the engine blurs the picture once, so only two static pictures are drawn here
+    readonly property bool blur: wallpaper.configuration.Blur
+                                 && (wallpaper.configuration.FillMode === Image.PreserveAspectFit
+                                     || wallpaper.configuration.FillMode === Image.Pad)
 
     PlasmaCore.DataSource {
         id: engine
         engine: "potd"
-        connectedSources: [identifier]
+        connectedSources: blur ? [identifier, "Backdrop:" + identifier] : [identifier]
     }
 
     Rectangle {
@@ -43,6 +47,16 @@ Rectangle {
         }
     }
 
+    Loader {
+        anchors.fill: parent
+        active: root.blur
+        sourceComponent: QImageItem {
+            image: engine.data["Backdrop:" + identifier].Image
+            fillMode: QImageItem.PreserveAspectCrop
+            smooth: true
+        }
+    }
+
     QImageItem {
         anchors.fill: parent
         image: engine.data[identifier].Image